@@ -11,16 +11,11 @@ void Board::print_board() {
     for (int rank = 0; rank < 8; rank++) {
         for (int file = 0; file < 8; file++) {
             int square = rank * 8 + file;
-            int piece = -1; // init as empty
+            int piece = piece_on[square];
 
             if (!file) {
                 printf(" %d  ", 8 - rank);
             }
-            for (int bb_piece = pawn; bb_piece <= king + 1; bb_piece++) {
-                if (get_bit(Board::piece_bitboards[bb_piece], square)) {
-                    piece = bb_piece;
-                }
-            }
             printf("%s ", (piece == -1) ? "." : unicode_pieces[piece]);
         }
         printf("\n");
@@ -46,25 +41,43 @@ void Board::makeMove(int move) {
     int castling = get_move_castling(move);
     U64 source_target = (1ULL << source_square) | (1ULL << target_square); // bb of both source and target squares
 
-    // save irreversible aspects of the position to history stacks
-    en_passant_history.push(enpassant_sq);
-    half_move_history.push(half_move);
-    castling_rights_history.push(castling_rights);
+    // save irreversible aspects of the position to the history array
+    check_info_parts = 0;
+    assert(ply < max_game_ply);
+    StateInfo &state = history[ply++];
+    state.hash_key = hash_key;
+    state.pawn_key = pawn_key;
+    state.enpassant_sq = enpassant_sq;
+    state.half_move = half_move;
+    state.captured_piece = capture ? get_move_captured_piece(move) : -1;
+    state.castling_rights = castling_rights;
+
+    // hash out the old castling rights and en passant square, they are hashed back in once updated
+    hash_key ^= castling_keys[castling_rights];
+    if (enpassant_sq != no_sq) hash_key ^= enpassant_keys[enpassant_sq];
 
     // if captured, remove it from the respective bitboard
     if (capture) {
-//        print_board();
         int captured_piece = get_move_captured_piece(move);
         // if the move is an en passant capture, remove the captured piece from correct square
         if (en_passant) {
             int ep_sq = side_to_move ? target_square - 8 : target_square + 8;
-//            printf("%s\n", square_to_cord[ep_sq]);
-//            print_board();
             pop_bit(piece_bitboards[!side_to_move], ep_sq);
+            pop_bit(occupancy_bitboards[!side_to_move], ep_sq);
+            pop_bit(occupancy_bitboards[all], ep_sq);
+            piece_on[ep_sq] = -1;
+            hash_key ^= piece_keys[!side_to_move][ep_sq];
+            pawn_key ^= piece_keys[!side_to_move][ep_sq];
+            psq_score -= piece_square_table.scores[!side_to_move][ep_sq];
         }
             // if not en passant, remove piece from expected target square
         else {
             pop_bit(piece_bitboards[captured_piece], target_square);
+            pop_bit(occupancy_bitboards[!side_to_move], target_square);
+            hash_key ^= piece_keys[captured_piece][target_square];
+            if (captured_piece == !side_to_move) pawn_key ^= piece_keys[captured_piece][target_square];
+            psq_score -= piece_square_table.scores[captured_piece][target_square];
+            phase -= phase_values[captured_piece >> 1];
         }
     }
         // castling
@@ -75,31 +88,64 @@ void Board::makeMove(int move) {
             // same idea for kings
             piece_bitboards[rook] ^= 0xa000000000000000;
             piece_bitboards[king] ^= 0x5000000000000000;
+            occupancy_bitboards[white] ^= 0xa000000000000000;
+            occupancy_bitboards[all] ^= 0xa000000000000000;
+            piece_on[h1] = -1;
+            piece_on[f1] = rook;
+            hash_key ^= piece_keys[rook][h1] ^ piece_keys[rook][f1];
+            psq_score += piece_square_table.scores[rook][f1] - piece_square_table.scores[rook][h1];
         } else if (target_square == c1) {
             piece_bitboards[rook] ^= 0x900000000000000;
             piece_bitboards[king] ^= 0x1400000000000000;
+            occupancy_bitboards[white] ^= 0x900000000000000;
+            occupancy_bitboards[all] ^= 0x900000000000000;
+            piece_on[a1] = -1;
+            piece_on[d1] = rook;
+            hash_key ^= piece_keys[rook][a1] ^ piece_keys[rook][d1];
+            psq_score += piece_square_table.scores[rook][d1] - piece_square_table.scores[rook][a1];
         } else if (target_square == g8) {
             piece_bitboards[rook + 1] ^= 0xa0;
             piece_bitboards[king + 1] ^= 0x50;
+            occupancy_bitboards[black] ^= 0xa0;
+            occupancy_bitboards[all] ^= 0xa0;
+            piece_on[h8] = -1;
+            piece_on[f8] = rook + 1;
+            hash_key ^= piece_keys[rook + 1][h8] ^ piece_keys[rook + 1][f8];
+            psq_score += piece_square_table.scores[rook + 1][f8] - piece_square_table.scores[rook + 1][h8];
         } else if (target_square == c8) {
             piece_bitboards[rook + 1] ^= 0x9;
             piece_bitboards[king + 1] ^= 0x14;
+            occupancy_bitboards[black] ^= 0x9;
+            occupancy_bitboards[all] ^= 0x9;
+            piece_on[a8] = -1;
+            piece_on[d8] = rook + 1;
+            hash_key ^= piece_keys[rook + 1][a8] ^ piece_keys[rook + 1][d8];
+            psq_score += piece_square_table.scores[rook + 1][d8] - piece_square_table.scores[rook + 1][a8];
         }
     }
-        // if the move is a double push, set en passant square
-    else if (double_push) {
-        int ep_sq = side_to_move ? source_square - 8 : source_square + 8;
+
+    // if the move is a double push, set en passant square, otherwise there is no en passant square
+    if (double_push) {
+        int ep_sq = side_to_move ? source_square + 8 : source_square - 8;
         enpassant_sq = ep_sq;
+        hash_key ^= enpassant_keys[enpassant_sq];
     } else {
-        // if not double push, set enpassant_sq to no_sq
         enpassant_sq = no_sq;
     }
 
     // if promoted, put promoted piece in respective bitboard, else put piece on target square
     if (promoted) {
         set_bit(piece_bitboards[promoted], target_square);
+        piece_on[target_square] = promoted;
+        hash_key ^= piece_keys[promoted][target_square];
+        psq_score += piece_square_table.scores[promoted][target_square];
+        phase += phase_values[promoted >> 1];
     } else {
         set_bit(piece_bitboards[piece], target_square);
+        piece_on[target_square] = piece;
+        hash_key ^= piece_keys[piece][target_square];
+        if (piece == side_to_move) pawn_key ^= piece_keys[piece][target_square];
+        psq_score += piece_square_table.scores[piece][target_square];
     }
 
     // if not capture or pawn push, increment half move counter
@@ -126,9 +172,14 @@ void Board::makeMove(int move) {
     if ((castling_rights & bq) && (0x11 & source_target)) {
         castling_rights &= ~bq;
     }
+    hash_key ^= castling_keys[castling_rights];
 
     // remove from piece bitboard
     pop_bit(piece_bitboards[piece], source_square);
+    piece_on[source_square] = -1;
+    hash_key ^= piece_keys[piece][source_square];
+    if (piece == side_to_move) pawn_key ^= piece_keys[piece][source_square];
+    psq_score -= piece_square_table.scores[piece][source_square];
 
     // update occupancies
     set_bit(occupancy_bitboards[side_to_move], target_square);
@@ -142,6 +193,7 @@ void Board::makeMove(int move) {
     }
 
     side_to_move = !side_to_move;
+    hash_key ^= side_key;
 }
 
 /// undo move in board state
@@ -164,10 +216,18 @@ void Board::undoMove(int move) {
         if (en_passant) {
             int ep_sq = side_to_move ? target_square - 8 : target_square + 8;
             set_bit(piece_bitboards[!side_to_move], ep_sq);
+            set_bit(occupancy_bitboards[!side_to_move], ep_sq);
+            set_bit(occupancy_bitboards[all], ep_sq);
+            piece_on[ep_sq] = (int8_t) !side_to_move;
+            psq_score += piece_square_table.scores[!side_to_move][ep_sq];
         }
             // if not en passant, put piece back on expected target square
         else {
             set_bit(piece_bitboards[captured_piece], target_square);
+            set_bit(occupancy_bitboards[!side_to_move], target_square);
+            piece_on[target_square] = captured_piece;
+            psq_score += piece_square_table.scores[captured_piece][target_square];
+            phase += phase_values[captured_piece >> 1];
         }
     }
         // undo castling
@@ -176,63 +236,181 @@ void Board::undoMove(int move) {
             // XOR masks stay the same, and will undo the castling move
             piece_bitboards[rook] ^= 0xa000000000000000;
             piece_bitboards[king] ^= 0x5000000000000000;
+            occupancy_bitboards[white] ^= 0xa000000000000000;
+            occupancy_bitboards[all] ^= 0xa000000000000000;
+            piece_on[h1] = rook;
+            piece_on[f1] = -1;
+            psq_score -= piece_square_table.scores[rook][f1] - piece_square_table.scores[rook][h1];
         } else if (target_square == c1) {
             piece_bitboards[rook] ^= 0x900000000000000;
             piece_bitboards[king] ^= 0x1400000000000000;
+            occupancy_bitboards[white] ^= 0x900000000000000;
+            occupancy_bitboards[all] ^= 0x900000000000000;
+            piece_on[a1] = rook;
+            piece_on[d1] = -1;
+            psq_score -= piece_square_table.scores[rook][d1] - piece_square_table.scores[rook][a1];
         } else if (target_square == g8) {
             piece_bitboards[rook + 1] ^= 0xa0;
             piece_bitboards[king + 1] ^= 0x50;
+            occupancy_bitboards[black] ^= 0xa0;
+            occupancy_bitboards[all] ^= 0xa0;
+            piece_on[h8] = rook + 1;
+            piece_on[f8] = -1;
+            psq_score -= piece_square_table.scores[rook + 1][f8] - piece_square_table.scores[rook + 1][h8];
         } else if (target_square == c8) {
             piece_bitboards[rook + 1] ^= 0x9;
             piece_bitboards[king + 1] ^= 0x14;
+            occupancy_bitboards[black] ^= 0x9;
+            occupancy_bitboards[all] ^= 0x9;
+            piece_on[a8] = rook + 1;
+            piece_on[d8] = -1;
+            psq_score -= piece_square_table.scores[rook + 1][d8] - piece_square_table.scores[rook + 1][a8];
         }
     }
 
     // undo promotion
     if (promoted) {
         pop_bit(piece_bitboards[promoted], target_square);
+        psq_score -= piece_square_table.scores[promoted][target_square];
+        phase -= phase_values[promoted >> 1];
     } else {
         pop_bit(piece_bitboards[piece], target_square);
+        psq_score -= piece_square_table.scores[piece][target_square];
     }
 
     // add back to piece bitboard
     set_bit(piece_bitboards[piece], source_square);
+    piece_on[source_square] = piece;
+    psq_score += piece_square_table.scores[piece][source_square];
 
     // update occupancies
     pop_bit(occupancy_bitboards[side_to_move], target_square);
-    pop_bit(occupancy_bitboards[all], target_square);
     set_bit(occupancy_bitboards[side_to_move], source_square);
     set_bit(occupancy_bitboards[all], source_square);
+    // the target square is only empty again if nothing was captured on it
+    if (!capture || en_passant) {
+        pop_bit(occupancy_bitboards[all], target_square);
+        piece_on[target_square] = -1;
+    }
 
     // if it is the end of black's turn, decrement full move counter
     if (side_to_move) {
         full_move--;
     }
 
-    // restore irreversible aspects of position from history stacks
-    int temp = half_move_history.size();
-    enpassant_sq = en_passant_history.top();
-    en_passant_history.pop();
+    // restore irreversible aspects of position from the history array
+    check_info_parts = 0;
+    const StateInfo &state = history[--ply];
+    hash_key = state.hash_key;
+    pawn_key = state.pawn_key;
+    enpassant_sq = state.enpassant_sq;
+    half_move = state.half_move;
+    castling_rights = state.castling_rights;
+}
+
+/// get legal moves of current position
+/// \return list of legal moves
+MoveList Board::get_legal_moves() {
+    MoveList legal_moves;
+    const CheckInfo &info = get_check_info();
+    if (info.num_checkers) {
+        generate_legal_moves<gen_evasions>(legal_moves, info, occupancy_bitboards, piece_bitboards, piece_on,
+                                           side_to_move, castling_rights, enpassant_sq);
+    } else {
+        generate_legal_moves<gen_all>(legal_moves, info, occupancy_bitboards, piece_bitboards, piece_on,
+                                      side_to_move, castling_rights, enpassant_sq);
+    }
+    return legal_moves;
+}
+
+/// get the check info of the current position, working out any of the parts asked for that haven't been yet
+/// the reference is only good until the next makeMove/undoMove, copy it to keep it across moves
+/// \param parts CheckInfoParts flags of the parts needed
+/// \return const CheckInfo&
+const CheckInfo &Board::get_check_info(int parts) {
+    int missing = parts & ~check_info_parts;
+    if (missing) {
+        init_check_info(check_info, occupancy_bitboards, piece_bitboards, side_to_move, missing);
+        check_info_parts |= missing;
+    }
+    return check_info;
+}
 
-    half_move = half_move_history.top();
-    half_move_history.pop();
+/// \return bool true if the side to move is in check
+bool Board::in_check() {
+    return get_check_info(check_info_pins).num_checkers > 0;
+}
 
-    castling_rights = castling_rights_history.top();
-    castling_rights_history.pop();
+/// check for a draw by the fifty move rule or by repetition of a position played since load_FEN
+/// a single repetition counts, which is all a search needs to avoid looping
+/// \return bool true if the position is drawn
+bool Board::is_draw() {
+    if (half_move >= 100) return true;
+    // only positions since the last capture or pawn move can repeat, and only every other one has the same side to move
+    for (int i = ply - 2; i >= 0 && i >= ply - half_move; i -= 2) {
+        if (history[i].hash_key == hash_key) return true;
+    }
+    return false;
+}
 
+/// forget the moves played since load_FEN that can't matter to repetition any more, freeing their history entries
+/// only positions since the last capture or pawn move can repeat, the moves before them can't be undone afterwards
+void Board::trim_history() {
+    // past the fifty move rule is_draw doesn't look at the history at all
+    int keep = std::min(std::min(half_move, 100), ply);
+    std::copy(history + ply - keep, history + ply, history);
+    ply = keep;
 }
 
-/// get legal moves of current position
-/// \return vector of legal moves
-std::vector<int> Board::get_legal_moves() {
-    std::vector<int> legal_moves = generate_legal_moves(occupancy_bitboards, piece_bitboards, side_to_move,
-                                                        castling_rights, enpassant_sq);
-    return legal_moves;
+/// check if a legal move gives check
+/// \param move
+/// \return bool true if the opponent will be in check after the move
+bool Board::gives_check(int move) {
+    return ::gives_check(move, get_check_info(check_info_check_squares), occupancy_bitboards, piece_bitboards,
+                         side_to_move);
+}
+
+/// the hash key of the position after a move, without making it
+/// castling rights and the castling rook are left out, so it is only for prefetching the child's table entry
+/// early, a move that changes them just prefetches the wrong line
+/// \param move
+/// \return U64 hash key after the move, or close to it
+U64 Board::key_after(int move) const {
+    int source_square = get_move_source(move);
+    int target_square = get_move_target(move);
+    int piece = get_move_piece(move);
+    int promoted = get_move_promoted(move);
+
+    U64 key = hash_key ^ side_key ^ piece_keys[piece][source_square] ^
+              piece_keys[promoted ? promoted : piece][target_square];
+    if (enpassant_sq != no_sq) key ^= enpassant_keys[enpassant_sq];
+    if (get_move_enpassant(move)) {
+        key ^= piece_keys[!side_to_move][side_to_move ? target_square - 8 : target_square + 8];
+    } else if (get_move_capture(move)) {
+        key ^= piece_keys[get_move_captured_piece(move)][target_square];
+    }
+    if (get_move_double_push(move)) key ^= enpassant_keys[side_to_move ? source_square + 8 : source_square - 8];
+    return key;
+}
+
+/// get the pieces of both sides attacking a square
+/// \param square
+/// \param occupancy occupied squares to look through with sliders, usually occupancy_bitboards[all]
+/// \return U64 attackers
+U64 Board::attackers_to(int square, U64 occupancy) const {
+    return ::attackers_to(square, occupancy, piece_bitboards);
+}
+
+/// static exchange evaluation of a move, usually a capture
+/// \param move legal move
+/// \return int material the side to move wins by it, negative if it loses material
+int Board::see(int move) const {
+    return ::see(move, occupancy_bitboards, piece_bitboards, side_to_move);
 }
 
 /// print legal moves
 /// \param legal_moves
-void Board::print_legal_moves(const std::vector<int> &legal_moves) {
+void Board::print_legal_moves(const MoveList &legal_moves) {
     int num = 0;
     for (int move: legal_moves) {
         if (get_move_promoted(move)) {
@@ -247,6 +425,40 @@ void Board::print_legal_moves(const std::vector<int> &legal_moves) {
     }
 }
 
+/// generate the zobrist key of the current position from scratch
+/// https://www.chessprogramming.org/Zobrist_Hashing
+/// \return U64 hash key
+U64 Board::generate_hash_key() {
+    U64 key = 0ULL;
+
+    // hash pieces
+    for (int piece = pawn; piece <= king + 1; piece++) {
+        U64 bitboard = piece_bitboards[piece];
+        for (int square = 0; square < 64; square++) {
+            if (get_bit(bitboard, square)) key ^= piece_keys[piece][square];
+        }
+    }
+
+    // hash en passant square, castling rights and side to move
+    if (enpassant_sq != no_sq) key ^= enpassant_keys[enpassant_sq];
+    key ^= castling_keys[castling_rights];
+    if (side_to_move) key ^= side_key;
+
+    return key;
+}
+
+/// generate the pawn key of the position from scratch
+/// \return U64 zobrist key of both sides' pawns
+U64 Board::generate_pawn_key() {
+    U64 key = pawn_key_seed;
+    for (int side = white; side <= black; side++) {
+        U64 bitboard = piece_bitboards[pawn + side];
+        for (int square = 0; square < 64; square++) {
+            if (get_bit(bitboard, square)) key ^= piece_keys[pawn + side][square];
+        }
+    }
+    return key;
+}
 
 /// load board position from FEN position
 /// \param FEN
@@ -257,6 +469,9 @@ void Board::load_FEN(const std::string &FEN) {
     // set all bitboards to empty
     std::fill(piece_bitboards, piece_bitboards + 12, 0ULL);
     std::fill(occupancy_bitboards, occupancy_bitboards + 3, 0ULL);
+    std::fill(piece_on, piece_on + 64, -1);
+    psq_score = 0;
+    phase = 0;
 
     std::istringstream iss(FEN);
     std::string board_state, side, castling, en_passant, half, full;
@@ -329,6 +544,9 @@ void Board::load_FEN(const std::string &FEN) {
             // get the piece type and set it on appropriate bitboard
             piece_type = std::distance(std::begin(pieces), result);
             set_bit(piece_bitboards[piece_type], square);
+            piece_on[square] = (int8_t) piece_type;
+            psq_score += piece_square_table.scores[piece_type][square];
+            phase += phase_values[piece_type >> 1];
 
             // increment FEN position counter
             pos++;
@@ -342,5 +560,13 @@ void Board::load_FEN(const std::string &FEN) {
         occupancy_bitboards[black] |= piece_bitboards[piece + 1];
     }
     occupancy_bitboards[all] = occupancy_bitboards[white] | occupancy_bitboards[black];
+
+    // seed the hash key, it is updated incrementally from here on
+    hash_key = generate_hash_key();
+    pawn_key = generate_pawn_key();
+
+    // moves played before this position can't be undone
+    ply = 0;
+    check_info_parts = 0;
 }
 
@@ -6,10 +6,30 @@
 #define BITBOARDS_BOARD_H
 
 #include "utils.h"
-#include "vector"
+#include "Zobrist.h"
+#include "MoveGeneration.h"
+#include "Evaluation.h"
 #include <string>
 #include <sstream>
-#include <stack>
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <type_traits>
+
+// irreversible aspects of a position, saved before each move so it can be undone
+// https://www.chessprogramming.org/Unmake_Move
+struct StateInfo {
+    U64 hash_key;
+    U64 pawn_key;
+    int enpassant_sq;
+    int half_move;
+    int captured_piece;
+    uint8_t castling_rights;
+};
+
+// most plies that can be played on a board after load_FEN, makeMove asserts it isn't played past
+// something playing out a longer game has to call trim_history (or load_FEN) before it runs out
+const int max_game_ply = 1024;
 
 class Board {
 public:
@@ -19,6 +39,16 @@ public:
                                0x2400000000000000, 0x0000000000000024, 0x8100000000000000, 0x0000000000000081,
                                0x0800000000000000, 0x0000000000000008, 0x1000000000000000, 0x0000000000000010,};
 
+    // piece on each square, -1 if empty, kept in step with piece_bitboards
+    int8_t piece_on[64] = {7, 3, 5, 9, 11, 5, 3, 7,
+                           1, 1, 1, 1, 1, 1, 1, 1,
+                           -1, -1, -1, -1, -1, -1, -1, -1,
+                           -1, -1, -1, -1, -1, -1, -1, -1,
+                           -1, -1, -1, -1, -1, -1, -1, -1,
+                           -1, -1, -1, -1, -1, -1, -1, -1,
+                           0, 0, 0, 0, 0, 0, 0, 0,
+                           6, 2, 4, 8, 10, 4, 2, 6,};
+
     // occupancies, white, black, both
     U64 occupancy_bitboards[3] = {0xffff000000000000, 0x000000000000ffff, 0xffff00000000ffff,};
 
@@ -28,30 +58,64 @@ public:
 
     uint8_t castling_rights = 0xf;
 
-    // stacks for irreversible aspects of position
-    // https://www.chessprogramming.org/Unmake_Move
-    std::stack<uint8_t> castling_rights_history;
+    // state before each move played since load_FEN, indexed by ply
+    StateInfo history[max_game_ply];
 
-    std::stack<int> en_passant_history;
-
-    std::stack<int> half_move_history;
+    int ply = 0; // number of moves played since load_FEN
 
     int half_move = 0; // move counter since pawn push or capture for 50 move rule
 
     int full_move = 1; // move number of game
 
+    U64 hash_key = 0ULL; // zobrist key of the position, seeded in load_FEN and updated incrementally
+
+    U64 pawn_key = 0ULL; // zobrist key of the pawns alone, it only changes when a pawn moves, is taken or promotes
+
+    // material and piece-square score of both sides (white minus black, packed by make_score) and the game phase
+    // seeded in load_FEN and updated incrementally, so evaluating a position doesn't have to look at the pieces
+    // the starting position is symmetric, so its score is 0
+    int psq_score = 0;
+    int phase = max_phase;
+
+    // checkers, pins and check squares of the current position
+    // worked out on first use and thrown away whenever the position changes
+    CheckInfo check_info;
+    uint8_t check_info_parts = 0; // CheckInfoParts flags of the parts worked out so far
+
+    U64 generate_hash_key();
+    U64 generate_pawn_key();
+
     void load_FEN(const std::string& FEN);
 
     void makeMove(int move);
     void undoMove(int move);
 
-    std::vector<int> get_legal_moves();
+    MoveList get_legal_moves();
+
+    const CheckInfo &get_check_info(int parts = check_info_legal);
+
+    bool in_check();
+
+    bool gives_check(int move);
+
+    U64 key_after(int move) const;
+
+    U64 attackers_to(int square, U64 occupancy) const;
+
+    int see(int move) const;
+
+    bool is_draw();
+
+    void trim_history();
 
     void print_board();
 
-    void print_legal_moves(const std::vector<int>& legal_moves);
+    void print_legal_moves(const MoveList& legal_moves);
 
 };
 
+// boards are copied by memcpy when handed to other threads
+static_assert(std::is_trivially_copyable<Board>::value, "Board must be trivially copyable");
+
 
 #endif //BITBOARDS_BOARD_H
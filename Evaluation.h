@@ -0,0 +1,38 @@
+//
+// Created by Hayden Collins on 1/12/24.
+//
+
+#ifndef BITBOARDS_EVALUATION_H
+#define BITBOARDS_EVALUATION_H
+
+#include "utils.h"
+#include <cstdint>
+
+class Board;
+
+class PawnTable;
+
+// middlegame and endgame scores packed into one int, so both are updated with a single add
+// the endgame score sits in the high 16 bits, the middlegame score in the low 16 (borrowing from the high half
+// when it is negative)
+constexpr int make_score(int mg, int eg) { return eg * 65536 + mg; }
+
+inline int mg_value(int score) { return (int16_t) (uint16_t) (unsigned) score; }
+
+inline int eg_value(int score) { return (int16_t) (uint16_t) ((unsigned) (score + 0x8000) >> 16); }
+
+// weight of each piece type in the game phase, pawn/knight/bishop/rook/queen/king
+// the phase is max_phase with every piece on the board and falls towards 0 (the endgame) as they come off
+const int phase_values[6] = {0, 1, 1, 2, 4, 0};
+const int max_phase = 24;
+
+// material plus piece-square score of each piece on each square, white's pieces positive and black's negative
+struct PieceSquareTable {
+    int scores[12][64];
+};
+
+extern const PieceSquareTable piece_square_table;
+
+int evaluate(const Board &board, PawnTable &pawn_table);
+
+#endif //BITBOARDS_EVALUATION_H
@@ -3,27 +3,74 @@
 //
 
 #include "MoveGeneration.h"
-
-// count the number of bits in a bitboard
-static inline int count_bits(U64 bitboard) {
-    int count = 0;
-
-    while (bitboard) {
-        count++;
-        bitboard &= bitboard - 1;  // reset least significant 1st bit
-    }
-    return count;
-}
-
-// get least significant 1st bit (ls1b) index
-static inline int get_ls1b_index(U64 bitboard) {
-    if (bitboard) {
-        // count bits before ls1b
-        return count_bits((bitboard & -bitboard) - 1);
-    } else {
-        return -1;
-    }
-}
+#include <algorithm>
+
+// relevant castling bitboards
+// squares to check if attacked
+// wk, wq, bk, bq
+static constexpr U64 castling_squares[4] = {0x6000000000000000, 0xc00000000000000, 0x000000000060, 0x00000000000c};
+// squares to check if occupied (only different for queenside, because b1/8 has to be empty, but can be attacked)
+static constexpr U64 queenside_occupancy[2] = {0xe00000000000000, 0x00000000000e};
+// how many bits a rook attacks from each square, not including edge squares
+
+
+static constexpr int rook_relevant_bits[64] = {12, 11, 11, 11, 11, 11, 11, 12, 11, 10, 10, 10, 10, 10, 10, 11, 11, 10, 10, 10, 10,
+                                     10, 10, 11, 11, 10, 10, 10, 10, 10, 10, 11, 11, 10, 10, 10, 10, 10, 10, 11, 11, 10,
+                                     10, 10, 10, 10, 10, 11, 11, 10, 10, 10, 10, 10, 10, 11, 12, 11, 11, 11, 11, 11, 11,
+                                     12};
+
+// how many bits a bishop attacks from each square, not including edge squares
+static constexpr int bishop_relevant_bits[64] = {6, 5, 5, 5, 5, 5, 5, 6, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 7, 7, 7, 7, 5, 5, 5, 5, 7,
+                                       9, 9, 7, 5, 5, 5, 5, 7, 9, 9, 7, 5, 5, 5, 5, 7, 7, 7, 7, 5, 5, 5, 5, 5, 5, 5, 5,
+                                       5, 5, 6, 5, 5, 5, 5, 5, 5, 6};
+
+// rook magic numbers
+// sourced from https://www.youtube.com/watch?v=UnEu5GOiSEs&list=PLmN0neTso3Jxh8ZIylk74JpwfiWNI76Cs&index=16
+static constexpr U64 rook_magic_nums[64] = {0x8a80104000800020ULL, 0x140002000100040ULL, 0x2801880a0017001ULL,
+                                  0x100081001000420ULL, 0x200020010080420ULL, 0x3001c0002010008ULL,
+                                  0x8480008002000100ULL, 0x2080088004402900ULL, 0x800098204000ULL,
+                                  0x2024401000200040ULL, 0x100802000801000ULL, 0x120800800801000ULL,
+                                  0x208808088000400ULL, 0x2802200800400ULL, 0x2200800100020080ULL, 0x801000060821100ULL,
+                                  0x80044006422000ULL, 0x100808020004000ULL, 0x12108a0010204200ULL,
+                                  0x140848010000802ULL, 0x481828014002800ULL, 0x8094004002004100ULL,
+                                  0x4010040010010802ULL, 0x20008806104ULL, 0x100400080208000ULL, 0x2040002120081000ULL,
+                                  0x21200680100081ULL, 0x20100080080080ULL, 0x2000a00200410ULL, 0x20080800400ULL,
+                                  0x80088400100102ULL, 0x80004600042881ULL, 0x4040008040800020ULL, 0x440003000200801ULL,
+                                  0x4200011004500ULL, 0x188020010100100ULL, 0x14800401802800ULL, 0x2080040080800200ULL,
+                                  0x124080204001001ULL, 0x200046502000484ULL, 0x480400080088020ULL,
+                                  0x1000422010034000ULL, 0x30200100110040ULL, 0x100021010009ULL, 0x2002080100110004ULL,
+                                  0x202008004008002ULL, 0x20020004010100ULL, 0x2048440040820001ULL,
+                                  0x101002200408200ULL, 0x40802000401080ULL, 0x4008142004410100ULL,
+                                  0x2060820c0120200ULL, 0x1001004080100ULL, 0x20c020080040080ULL, 0x2935610830022400ULL,
+                                  0x44440041009200ULL, 0x280001040802101ULL, 0x2100190040002085ULL,
+                                  0x80c0084100102001ULL, 0x4024081001000421ULL, 0x20030a0244872ULL, 0x12001008414402ULL,
+                                  0x2006104900a0804ULL, 0x1004081002402ULL};
+
+// bishop magic numbers
+static constexpr U64 bishop_magic_nums[64] = {0x40040844404084ULL, 0x2004208a004208ULL, 0x10190041080202ULL, 0x108060845042010ULL,
+                                    0x581104180800210ULL, 0x2112080446200010ULL, 0x1080820820060210ULL,
+                                    0x3c0808410220200ULL, 0x4050404440404ULL, 0x21001420088ULL, 0x24d0080801082102ULL,
+                                    0x1020a0a020400ULL, 0x40308200402ULL, 0x4011002100800ULL, 0x401484104104005ULL,
+                                    0x801010402020200ULL, 0x400210c3880100ULL, 0x404022024108200ULL,
+                                    0x810018200204102ULL, 0x4002801a02003ULL, 0x85040820080400ULL,
+                                    0x810102c808880400ULL, 0xe900410884800ULL, 0x8002020480840102ULL,
+                                    0x220200865090201ULL, 0x2010100a02021202ULL, 0x152048408022401ULL,
+                                    0x20080002081110ULL, 0x4001001021004000ULL, 0x800040400a011002ULL,
+                                    0xe4004081011002ULL, 0x1c004001012080ULL, 0x8004200962a00220ULL,
+                                    0x8422100208500202ULL, 0x2000402200300c08ULL, 0x8646020080080080ULL,
+                                    0x80020a0200100808ULL, 0x2010004880111000ULL, 0x623000a080011400ULL,
+                                    0x42008c0340209202ULL, 0x209188240001000ULL, 0x400408a884001800ULL,
+                                    0x110400a6080400ULL, 0x1840060a44020800ULL, 0x90080104000041ULL,
+                                    0x201011000808101ULL, 0x1a2208080504f080ULL, 0x8012020600211212ULL,
+                                    0x500861011240000ULL, 0x180806108200800ULL, 0x4000020e01040044ULL,
+                                    0x300000261044000aULL, 0x802241102020002ULL, 0x20906061210001ULL,
+                                    0x5a84841004010310ULL, 0x4010801011c04ULL, 0xa010109502200ULL, 0x4a02012000ULL,
+                                    0x500201010098b028ULL, 0x8040002811040900ULL, 0x28000010020204ULL,
+                                    0x6000020202d0240ULL, 0x8918844842082200ULL, 0x4010011029020020ULL};
+
+#if defined(USE_PEXT)
+#include <immintrin.h>
+#endif
 
 /// shifts all bits in a bitboard up one rank
 /// \param bitboard U64
@@ -40,7 +87,7 @@ static inline U64 south_one(U64 bitboard) {
 }
 
 // get pawn attack mask
-static U64 mask_pawn_attacks(int side, int square) {
+static constexpr U64 mask_pawn_attacks(int side, int square) {
     U64 attacks = 0ULL;
     U64 bitboard = 0ULL;
 
@@ -62,20 +109,22 @@ static U64 mask_pawn_attacks(int side, int square) {
 
 
 /// get single pawn push targets
-/// \param side 0 for black, 1 for white
+/// \tparam side 0 for white, 1 for black
 /// \param pawns bitboard of pawn locations
 /// \param empty bitboard of empty squares
 /// \return bitboard of possible pawn pushes
-static U64 mask_single_pawn_pushes(int side, U64 pawns, U64 empty) {
+template<int side>
+static U64 mask_single_pawn_pushes(U64 pawns, U64 empty) {
     return side ? (south_one(pawns) & empty) : (north_one(pawns) & empty);
 }
 
 /// get double pawn push targets
-/// \param side 0 for black, 1 for white
+/// \tparam side 0 for white, 1 for black
 /// \param single_pushes bitboard of available single pawn pushes
 /// \param empty bitboard of empty squares
 /// \return U64 bitboard of possible pawn pushes
-static U64 mask_double_pawn_pushes(int side, U64 single_pushes, U64 empty) {
+template<int side>
+static U64 mask_double_pawn_pushes(U64 single_pushes, U64 empty) {
     // white
     if (!side) {
         // push single pushes forward one more, only if target square is empty and on the 4th rank
@@ -89,7 +138,7 @@ static U64 mask_double_pawn_pushes(int side, U64 single_pushes, U64 empty) {
 
 
 // bit shifts to get knight attacks
-static U64 mask_knight_attacks(int square) {
+static constexpr U64 mask_knight_attacks(int square) {
     U64 attacks = 0ULL;
     U64 bitboard = 0ULL;
 
@@ -109,7 +158,7 @@ static U64 mask_knight_attacks(int square) {
 }
 
 // get king attack mask using bit shifts
-static U64 mask_king_attacks(int square) {
+static constexpr U64 mask_king_attacks(int square) {
     U64 attacks = 0ULL;
     U64 bitboard = 0ULL;
 
@@ -130,10 +179,10 @@ static U64 mask_king_attacks(int square) {
 
 // generate occupancy squares for bishop moves
 // basically get all the squares the bishop attacks, not including the edge of the board
-static U64 mask_bishop_attacks(int square) {
+static constexpr U64 mask_bishop_attacks(int square) {
     U64 attacks = 0ULL;
 
-    int rank, file;
+    int rank = 0, file = 0;
 
     int target_rank = square / 8;
     int target_file = square % 8;
@@ -160,10 +209,10 @@ static U64 mask_bishop_attacks(int square) {
 }
 
 // generate all squares is_attacked by a bishop, including the edge squares
-static U64 generate_bishop_attacks(int square, U64 block) {
+static constexpr U64 generate_bishop_attacks(int square, U64 block) {
     U64 attacks = 0ULL;
 
-    int rank, file;
+    int rank = 0, file = 0;
 
     int target_rank = square / 8;
     int target_file = square % 8;
@@ -196,10 +245,10 @@ static U64 generate_bishop_attacks(int square, U64 block) {
 
 // generate occupancy squares for rook moves
 // basically get all the squares the rook attacks, not including the edge of the board
-static U64 mask_rook_attacks(int square) {
+static constexpr U64 mask_rook_attacks(int square) {
     U64 attacks = 0ULL;
 
-    int rank, file;
+    int rank = 0, file = 0;
 
     int target_rank = square / 8;
     int target_file = square % 8;
@@ -214,10 +263,10 @@ static U64 mask_rook_attacks(int square) {
 }
 
 // generate all squares is_attacked by a rook, including the edge squares
-static U64 generate_rook_attacks(int square, U64 block) {
+static constexpr U64 generate_rook_attacks(int square, U64 block) {
     U64 attacks = 0ULL;
 
-    int rank, file;
+    int rank = 0, file = 0;
 
     int target_rank = square / 8;
     int target_file = square % 8;
@@ -243,92 +292,134 @@ static U64 generate_rook_attacks(int square, U64 block) {
     return attacks;
 }
 
-// set the occupancy for a bitboard
-static U64 set_occupancy(int index, int bits_in_mask, U64 attack_mask) {
-    U64 occupancy = 0ULL;
-
-    for (int i = 0; i < bits_in_mask; i++) {
-        // get ls1b
-        int square = get_ls1b_index(attack_mask);
-
-        // pop ls1b
-        pop_bit(attack_mask, square);
+/// every pre-calculated attack table, built by the constructor at compile time so the tables end up in
+/// read-only data instead of being filled in at startup
+struct AttackTables {
+    // attacks masks
+    U64 bishop_masks[64];
+    U64 rook_masks[64];
+
+    // non-sliding pieces
+    U64 pawn_attacks[2][64]; // [color][square]
+    U64 knight_attacks[64]; // [square]
+    U64 king_attacks[64]; // [square]
+
+    // sliding pieces
+    U64 bishop_attacks[bishop_attacks_size]; // [bishop_offsets[square] + occupancy index]
+    U64 rook_attacks[rook_attacks_size]; // [rook_offsets[square] + occupancy index]
+    int bishop_offsets[64];
+    int rook_offsets[64];
+
+    // the whole line (edge to edge) through two squares on a shared rank, file or diagonal, 0 if they don't share one
+    U64 line[64][64]; // [square][square]
+
+    constexpr AttackTables() : bishop_masks(), rook_masks(), pawn_attacks(), knight_attacks(), king_attacks(),
+                               bishop_attacks(), rook_attacks(), bishop_offsets(), rook_offsets(), line() {
+        // non-sliding pieces (pawn, king, knight)
+        for (int square = 0; square < 64; square++) {
+            pawn_attacks[white][square] = mask_pawn_attacks(white, square);
+            pawn_attacks[black][square] = mask_pawn_attacks(black, square);
+            knight_attacks[square] = mask_knight_attacks(square);
+            king_attacks[square] = mask_king_attacks(square);
+        }
 
-        // if occupancy is on board
-        if (index & (1 << i)) {
-            // populate occupancy bitboard
-            occupancy |= (1ULL << square);
+        // sliding pieces (rook + bishop)
+        int bishop_offset = 0;
+        int rook_offset = 0;
+        for (int square = 0; square < 64; square++) {
+            bishop_masks[square] = mask_bishop_attacks(square);
+            rook_masks[square] = mask_rook_attacks(square);
+
+            // each square's entries start where the previous square's ended
+            bishop_offsets[square] = bishop_offset;
+            rook_offsets[square] = rook_offset;
+            bishop_offset += 1 << bishop_relevant_bits[square];
+            rook_offset += 1 << rook_relevant_bits[square];
+
+            fill_slider_attacks(square, 1);
+            fill_slider_attacks(square, 0);
         }
-    }
-    return occupancy;
-}
 
-// fill attack tables for the non-sliding pieces (pawn, king, knight)
-static void generate_attack_tables_non_sliding() {
-    for (int square = 0; square < 64; square++) { // loop through every square
-        // fill table for given square
-        pawn_attacks[white][square] = mask_pawn_attacks(white, square);
-        pawn_attacks[black][square] = mask_pawn_attacks(black, square);
-        knight_attacks[square] = mask_knight_attacks(square);
-        king_attacks[square] = mask_king_attacks(square);
+        // lines, two squares' empty board attacks overlap on the line they share (and nowhere else on it)
+        U64 empty_bishop_attacks[64] = {};
+        U64 empty_rook_attacks[64] = {};
+        for (int square = 0; square < 64; square++) {
+            empty_bishop_attacks[square] = generate_bishop_attacks(square, 0ULL);
+            empty_rook_attacks[square] = generate_rook_attacks(square, 0ULL);
+        }
+        for (int from = 0; from < 64; from++) {
+            for (int to = 0; to < 64; to++) {
+                U64 ends = (1ULL << from) | (1ULL << to);
+                if (get_bit(empty_bishop_attacks[from], to)) {
+                    line[from][to] = (empty_bishop_attacks[from] & empty_bishop_attacks[to]) | ends;
+                } else if (get_bit(empty_rook_attacks[from], to)) {
+                    line[from][to] = (empty_rook_attacks[from] & empty_rook_attacks[to]) | ends;
+                }
+            }
+        }
     }
-}
 
-// fill attack tables for sliding pieces (rook + bishop)
-static void generate_attack_tables_sliding(int bishop) {
-    for (int square = 0; square < 64; square++) {
-        // init masks
-        bishop_masks[square] = mask_bishop_attacks(square);
-        rook_masks[square] = mask_rook_attacks(square);
-
-        // init current mask
+    /// fill one square's slider entries, walking every subset of the relevant occupancy mask
+    /// with the carry-rippler trick (much cheaper to evaluate at compile time than building each subset by index)
+    /// https://www.chessprogramming.org/Traversing_Subsets_of_a_Set
+    /// \param square int
+    /// \param bishop 1 for the bishop table, 0 for the rook table
+    constexpr void fill_slider_attacks(int square, int bishop) {
         U64 attack_mask = bishop ? bishop_masks[square] : rook_masks[square];
-
-        int relevant_bits_count = count_bits(attack_mask);
-
-        // init occupancy indices
-        int occupancy_indices = (1 << relevant_bits_count);
-
-        for (int i = 0; i < occupancy_indices; i++) {
-
+        U64 occupancy = 0ULL;
+        int index = 0;
+
+        do {
+#ifdef USE_PEXT
+            // subsets come out in the same order pext packs them, so the n-th subset is entry n
+            int magic_index = index;
+#else
+            // get the magic index from occupancy, magic number table, and relevant occupancy table
+            int magic_index = bishop ? (int) ((occupancy * bishop_magic_nums[square]) >> (64 - bishop_relevant_bits[square]))
+                                     : (int) ((occupancy * rook_magic_nums[square]) >> (64 - rook_relevant_bits[square]));
+#endif
             if (bishop) {
-                // current occupancy variation
-                U64 occupancy = set_occupancy(i, relevant_bits_count, attack_mask);
-                // get the magic index from occupancy, magic number table, and relevant occupancy table
-                int magic_index = (occupancy * bishop_magic_nums[square]) >> (64 - bishop_relevant_bits[square]);
-
-                //fill bishop attacks table
-                bishop_attacks[square][magic_index] = generate_bishop_attacks(square, occupancy);
-            } else { // rook
-                // current occupancy variation
-                U64 occupancy = set_occupancy(i, relevant_bits_count, attack_mask);
-                // get the magic index from occupancy, magic number table, and relevant occupancy table
-                int magic_index = (occupancy * rook_magic_nums[square]) >> (64 - rook_relevant_bits[square]);
-
-                //fill rook attacks table
-                rook_attacks[square][magic_index] = generate_rook_attacks(square, occupancy);
+                bishop_attacks[bishop_offsets[square] + magic_index] = generate_bishop_attacks(square, occupancy);
+            } else {
+                rook_attacks[rook_offsets[square] + magic_index] = generate_rook_attacks(square, occupancy);
             }
-        }
-    }
-}
 
-void fill_attack_tables() {
-    generate_attack_tables_non_sliding();
-    generate_attack_tables_sliding(1);
-    generate_attack_tables_sliding(0);
-}
+            index++;
+            occupancy = (occupancy - attack_mask) & attack_mask; // next subset
+        } while (occupancy);
+    }
+};
+
+static constexpr AttackTables attack_tables;
+
+// short names for the tables used throughout move generation
+static constexpr const U64 (&bishop_masks)[64] = attack_tables.bishop_masks;
+static constexpr const U64 (&rook_masks)[64] = attack_tables.rook_masks;
+static constexpr const U64 (&pawn_attacks)[2][64] = attack_tables.pawn_attacks;
+static constexpr const U64 (&knight_attacks)[64] = attack_tables.knight_attacks;
+static constexpr const U64 (&king_attacks)[64] = attack_tables.king_attacks;
+static constexpr const U64 (&bishop_attacks)[bishop_attacks_size] = attack_tables.bishop_attacks;
+static constexpr const U64 (&rook_attacks)[rook_attacks_size] = attack_tables.rook_attacks;
+static constexpr const int (&bishop_offsets)[64] = attack_tables.bishop_offsets;
+static constexpr const int (&rook_offsets)[64] = attack_tables.rook_offsets;
+static constexpr const U64 (&line)[64][64] = attack_tables.line;
 
 /// get bishop attacks using magic number for table lookup
 /// \param square int
 /// \param occupancy U64 bitboard of occupied squares
 /// \return U64 bitboard// get bishop attacks using magic number for table lookup
 static inline U64 get_bishop_attacks(int square, U64 occupancy) {
+#ifdef USE_PEXT
+    // BMI2 parallel bit extract of the relevant blockers is the table index
+    return bishop_attacks[bishop_offsets[square] + _pext_u64(occupancy, bishop_masks[square])];
+#else
     // get bishop attacks using current board occupancy
     occupancy &= bishop_masks[square]; // just the relevant blockers
     occupancy *= bishop_magic_nums[square]; // multiply by magic number
     occupancy >>= 64 - bishop_relevant_bits[square]; // shift out the garbage, the occupancy index remains
 
-    return bishop_attacks[square][occupancy]; // access pre-calculated table
+    return bishop_attacks[bishop_offsets[square] + occupancy]; // access pre-calculated table
+#endif
 }
 
 /// get rook attacks using magic number for table lookup
@@ -336,12 +427,17 @@ static inline U64 get_bishop_attacks(int square, U64 occupancy) {
 /// \param occupancy U64 bitboard of occupied squares
 /// \return U64 bitboard
 static inline U64 get_rook_attacks(int square, U64 occupancy) {
+#ifdef USE_PEXT
+    // BMI2 parallel bit extract of the relevant blockers is the table index
+    return rook_attacks[rook_offsets[square] + _pext_u64(occupancy, rook_masks[square])];
+#else
     // get rook attacks using current board occupancy
     occupancy &= rook_masks[square]; // just the relevant blockers
     occupancy *= rook_magic_nums[square]; // multiply by magic number
     occupancy >>= 64 - rook_relevant_bits[square]; // shift out the garbage, the occupancy index remains
 
-    return rook_attacks[square][occupancy]; // access pre-calculated table
+    return rook_attacks[rook_offsets[square] + occupancy]; // access pre-calculated table
+#endif
 }
 
 /// combining results of rook & bishop attack getters
@@ -459,8 +555,8 @@ U64 attacked_squares(const U64 occupancy_bitboards[3], const U64 piece_bitboards
         source_square = get_ls1b_index(rooksQueens);
         pop_bit(rooksQueens, source_square);
 
-        // use attack table lookup, & with friendly pieces to disallow self-capture
-        attacked |= get_rook_attacks(source_square, occupancy_bitboards[all]) & ~occupancy_bitboards[by_side];
+        // use attack table lookup
+        attacked |= get_rook_attacks(source_square, occupancy_bitboards[all]);
     }
 
     return attacked;
@@ -534,239 +630,304 @@ U64 get_slider_rays_from_square(int square, U64 opp_slider_pieces) {
 /// \return
 U64 opp_slider_rays_to_square(int from_square, int to_square, U64 occupancy) {
     U64 rays = 0ULL;
-    // if they are on the same file, then use rook attacks
-    if (from_square % 8 == to_square % 8) {
+    // if they are on the same file or rank, then use rook attacks
+    if (from_square % 8 == to_square % 8 || from_square / 8 == to_square / 8) {
         rays |= get_rook_attacks(from_square, occupancy) & get_rook_attacks(to_square, occupancy);
     }
-        // if not on same file, use bishop attacks
+        // if not on same file or rank, use bishop attacks
     else {
         rays |= get_bishop_attacks(from_square, occupancy) & get_bishop_attacks(to_square, occupancy);
     }
     return rays;
 }
 
+/// get the squares strictly between two squares on a shared diagonal, or a shared rank/file
+/// each square's rays are blocked by the other, so the rays only overlap in between the two squares
+/// \param from_square
+/// \param to_square
+/// \param diagonal true if the squares share a diagonal, false if they share a rank or file
+/// \return U64 bitboard
+static inline U64 squares_between(int from_square, int to_square, bool diagonal) {
+    U64 from_bb = 1ULL << from_square;
+    U64 to_bb = 1ULL << to_square;
+
+    if (diagonal) {
+        return get_bishop_attacks(from_square, to_bb) & get_bishop_attacks(to_square, from_bb);
+    }
+    return get_rook_attacks(from_square, to_bb) & get_rook_attacks(to_square, from_bb);
+}
+
+/// check if an en passant capture leaves our king safe by playing it out on a copy of the bitboards
+/// this catches the pawns being pinned together along the rank, and the move blocking or not blocking a check
+/// \param piece_bitboards
+/// \param occupancy bitboard of occupied squares
+/// \param king_square
+/// \param source_square square of the capturing pawn
+/// \param ep_sq en passant target square
+/// \param for_side side making the capture
+/// \return bool
+static bool is_legal_en_passant(const U64 piece_bitboards[12], U64 occupancy, int king_square, int source_square,
+                                int ep_sq, int for_side) {
+    U64 pieces[12];
+    std::copy(piece_bitboards, piece_bitboards + 12, pieces);
+    int captured_square = for_side ? ep_sq - 8 : ep_sq + 8;
+
+    // remove the captured pawn and move ours to the en passant square
+    pop_bit(pieces[pawn + !for_side], captured_square);
+    pop_bit(occupancy, captured_square);
+    pop_bit(occupancy, source_square);
+    set_bit(occupancy, ep_sq);
+
+    return !is_attacked(pieces, occupancy, king_square, !for_side);
+}
+
 /// get a bitboard of (absolutely) pinned pieces
+/// a piece is pinned if it is the only piece between the king and an opponent slider on the same line
 /// \param king_square
 /// \param opp_slider_pieces[2] bishopQueens, rookQueens
 /// \param occupancy[3] occupancy bitboards
 /// \return
 U64 get_pinned_pieces(int king_square, int for_side, const U64 opp_slider_pieces[2], U64 occupancy[3]) {
-    // init variables
-    U64 opp_bishop_attack_rays = 0ULL, opp_rook_attack_rays = 0ULL, pinned, king_rays;
-    U64 bishopQueens = opp_slider_pieces[0];
-    U64 rookQueens = opp_slider_pieces[1];
-    int from_square;
-
-    // get attacked squares by bishops
-    while (bishopQueens) {
-        from_square = get_ls1b_index(bishopQueens);
-        // if the bishop/queen is on the same diagonal as the king
-        if ((from_square - king_square) % 9 == 0 || (from_square - king_square) % 7 == 0) {
-            // calculate rays
-            opp_bishop_attack_rays |= get_bishop_attacks(from_square, 0ULL) & get_bishop_attacks(king_square, 0ULL);
-        }
-        pop_bit(bishopQueens, from_square);
-    }
+    U64 pinned = 0ULL;
 
-    // get bishop rays from king
-    king_rays = get_bishop_attacks(king_square, occupancy[all]);
+    // sliders that would attack the king on an empty board, bishop/queens on diagonals then rook/queens on lines
+    U64 snipers[2] = {get_bishop_attacks(king_square, 0ULL) & opp_slider_pieces[0],
+                      get_rook_attacks(king_square, 0ULL) & opp_slider_pieces[1]};
 
-    // save pieces pinned by bishops
-    pinned = opp_bishop_attack_rays & king_rays & occupancy[for_side];
+    for (int i = 0; i < 2; i++) {
+        while (snipers[i]) {
+            int sniper_square = get_ls1b_index(snipers[i]);
+            pop_bit(snipers[i], sniper_square);
 
-    // get attacked squares by rooks
-    while (rookQueens) {
-        from_square = get_ls1b_index(rookQueens);
-        opp_rook_attack_rays |= get_rook_attacks(from_square, occupancy[all]);
-        pop_bit(rookQueens, from_square);
+            // if exactly one piece blocks the ray and it is ours, it is pinned
+            U64 blockers = squares_between(king_square, sniper_square, i == 0) & occupancy[all];
+            if (count_bits(blockers) == 1) {
+                pinned |= blockers & occupancy[for_side];
+            }
+        }
     }
-
-    // get rook rays from king
-    king_rays = get_rook_attacks(king_square, occupancy[all]);
-
-    // save pieces pinned by rooks
-    pinned |= opp_rook_attack_rays & king_rays & occupancy[for_side];
-
     return pinned;
-
 }
 
-/// get the legal moves of a pinned piece
-/// could probably optimize to remove the redundant code from get_pinned_pieces
+/// get the legal moves of the pinned pieces
+/// a pinned piece can only move along the ray between the king and the pinner, or capture the pinner
+/// \param king_square
 /// \param for_side
-/// \param opp_slider_pieces
+/// \param opp_slider_pieces[2] bishopQueens, rookQueens
+/// \param piece_bitboards
+/// \param piece_on piece on each square, -1 if empty
 /// \param occupancy
-/// \param pinned
-/// \return
-std::vector<int>
-get_pinned_moves(int king_square, int for_side, const U64 opp_slider_pieces[2], const U64 piece_bitboards[12],
-                 const U64 occupancy[3], U64 pinned_pieces, U64 ep_bb) {
-    U64 opp_bishop_attack_rays = 0ULL, opp_rook_attack_rays = 0ULL, pinned_bishop_rays, pinned_rook_rays, temp_occupancy, target_squares = 0ULL, captures;
-    U64 bishopQueens = opp_slider_pieces[0];
-    U64 rookQueens = opp_slider_pieces[1];
-    std::vector<int> moves;
-    int pinned_square, pinned_piece_type = -1, pinner_square, target_square, move;
-    int possibly_pinned_pieces[4] = {pawn, bishop, rook, queen};
-
-    while (pinned_pieces) {
-        pinned_piece_type = -1;
-        pinned_square = get_ls1b_index(pinned_pieces);
-        pop_bit(pinned_pieces, pinned_square);
-
-        // determine pinned piece type
-        for (int piece_type: possibly_pinned_pieces) {
-            if (get_bit(piece_bitboards[piece_type + for_side], pinned_square)) {
-                pinned_piece_type = piece_type;
-            }
-        }
-
-        // if it is a pawn/bishop/rook/queen
-        if (pinned_piece_type != -1) {
-            // occupancy without the pinned piece
-            temp_occupancy = occupancy[all];
-            pop_bit(temp_occupancy, pinned_square);
-
-            // get attacked squares by bishops
-            while (bishopQueens) {
-                pinner_square = get_ls1b_index(bishopQueens);
-//                opp_bishop_attack_rays |= get_bishop_attacks(pinner_square, temp_occupancy);
-                // if the bishop/queen is on the same diagonal as the king
-                if ((pinner_square - king_square) % 9 == 0 || (pinner_square - king_square) % 7 == 0) {
-                    // calculate rays
-                    opp_bishop_attack_rays |=
-                            get_bishop_attacks(pinner_square, 0ULL) & get_bishop_attacks(king_square, 0ULL);
-                }
-
-                set_bit(opp_bishop_attack_rays, pinner_square);
-                pop_bit(bishopQueens, pinner_square);
-            }
-            // get attacked squares by rooks
-            while (rookQueens) {
-                pinner_square = get_ls1b_index(rookQueens);
-                if (pinner_square % 8 == king_square % 8 || pinner_square / 8 == king_square / 8) {
-                    opp_rook_attack_rays |= get_rook_attacks(pinner_square, temp_occupancy);
-                }
-                set_bit(opp_rook_attack_rays, pinner_square);
-                pop_bit(rookQueens, pinner_square);
-            }
-            // get rays from pinned piece
-            pinned_bishop_rays = get_bishop_attacks(pinned_square, occupancy[all]);
-            // get rays from pinned piece
-            pinned_rook_rays = get_rook_attacks(pinned_square, occupancy[all]);
-
-            // bishop / queen
-            if (pinned_piece_type == bishop || pinned_piece_type == queen) {
-                // get target squares along pinned diagonal
-                target_squares |= opp_bishop_attack_rays & pinned_bishop_rays & ~occupancy[for_side];
-            }
-                // pawn captures
-            else {
-                target_squares |= opp_bishop_attack_rays & occupancy[!for_side] & pawn_attacks[for_side][pinned_square];
-                // en passant
-                if (ep_bb & opp_bishop_attack_rays & pawn_attacks[for_side][pinned_square]) {
-                    target_square = get_ls1b_index(ep_bb);
-                    move = encode_move(pinned_square, target_square, (pawn + for_side), 0, 1, 0, 1, 0, !for_side);
-                    moves.push_back(move);
+/// \param pinned_pieces
+/// \param ep_bb bitboard of en passant square
+/// \tparam for_side
+/// \tparam gen_type GenType flags of the kinds of moves to add
+template<int for_side, int gen_type>
+void get_pinned_moves(MoveList &moves, int king_square, const U64 opp_slider_pieces[2],
+                      const U64 piece_bitboards[12], const int8_t piece_on[64], const U64 occupancy[3],
+                      U64 pinned_pieces, U64 ep_bb) {
+    U64 empty = ~occupancy[all];
+    const bool captures = gen_type & gen_captures;
+    const bool quiets = gen_type & gen_quiets;
+    // squares the requested kinds of moves can land on, pinned pieces can only promote by capturing the pinner
+    U64 target_filter = (captures ? occupancy[!for_side] : 0ULL) | (quiets ? empty : 0ULL);
+
+    // sliders that would attack the king on an empty board, bishop/queens on diagonals then rook/queens on lines
+    U64 snipers[2] = {get_bishop_attacks(king_square, 0ULL) & opp_slider_pieces[0],
+                      get_rook_attacks(king_square, 0ULL) & opp_slider_pieces[1]};
+
+    for (int i = 0; i < 2; i++) {
+        bool diagonal = (i == 0);
+        while (snipers[i]) {
+            int pinner_square = get_ls1b_index(snipers[i]);
+            pop_bit(snipers[i], pinner_square);
+
+            // the pin ray is every square between the king and the pinner, plus the pinner itself
+            // skip sliders that are blocked by more than one piece, they don't pin anything
+            U64 pin_ray = squares_between(king_square, pinner_square, diagonal);
+            U64 pinned = pin_ray & pinned_pieces;
+            if (!pinned || count_bits(pin_ray & occupancy[all]) != 1) continue;
+            set_bit(pin_ray, pinner_square);
+            int pinned_square = get_ls1b_index(pinned);
+
+            // determine pinned piece type (pinned knights can never move)
+            int pinned_piece_type = piece_on[pinned_square] - for_side;
+            if (pinned_piece_type == knight) continue;
+
+            U64 target_squares = 0ULL;
+            if (pinned_piece_type == pawn) {
+                if (diagonal) {
+                    // a pawn pinned on a diagonal can only capture the pinner (or en passant along the ray)
+                    target_squares = pawn_attacks[for_side][pinned_square] & pin_ray & occupancy[!for_side];
+                    if (captures && (ep_bb & pawn_attacks[for_side][pinned_square] & pin_ray)) {
+                        int ep_sq = get_ls1b_index(ep_bb);
+                        if (is_legal_en_passant(piece_bitboards, occupancy[all], king_square, pinned_square, ep_sq,
+                                                for_side)) {
+                            moves.push_back(encode_move(pinned_square, ep_sq, (pawn + for_side), 0, 1, 0, 1, 0,
+                                                        (pawn + !for_side)));
+                        }
+                    }
+                } else if (quiets) {
+                    // a pawn pinned on a file can still push
+                    U64 pawn_bb = 1ULL << pinned_square;
+                    U64 single_pawn_push = mask_single_pawn_pushes<for_side>(pawn_bb, empty) & pin_ray;
+                    U64 double_pawn_push = mask_double_pawn_pushes<for_side>(single_pawn_push, empty) & pin_ray;
+
+                    if (single_pawn_push) {
+                        moves.push_back(encode_move(pinned_square, get_ls1b_index(single_pawn_push),
+                                                    (pawn + for_side), 0, 0, 0, 0, 0, -1));
+                    }
+                    if (double_pawn_push) {
+                        moves.push_back(encode_move(pinned_square, get_ls1b_index(double_pawn_push),
+                                                    (pawn + for_side), 0, 0, 1, 0, 0, -1));
+                    }
                 }
+            } else if (diagonal && (pinned_piece_type == bishop || pinned_piece_type == queen)) {
+                target_squares = get_bishop_attacks(pinned_square, occupancy[all]) & pin_ray;
+            } else if (!diagonal && (pinned_piece_type == rook || pinned_piece_type == queen)) {
+                target_squares = get_rook_attacks(pinned_square, occupancy[all]) & pin_ray;
             }
-            // rook / queen
-            if (pinned_piece_type == rook || pinned_piece_type == queen) {
-                // get target squares along pinned diagonal
-                target_squares |= opp_rook_attack_rays & pinned_rook_rays & ~occupancy[for_side];
-            }
-                // pawn pushes
-            else {
-                // calculate pawn push bitboards
-                U64 empty = ~occupancy[all];
-                U64 single_pawn_pushes = mask_single_pawn_pushes(for_side, piece_bitboards[pawn + for_side], empty);
-                U64 double_pawn_pushes = mask_double_pawn_pushes(for_side, single_pawn_pushes, empty);
-
-                // add to target squares
-                target_squares |= opp_rook_attack_rays & single_pawn_pushes;
-                target_squares |= opp_rook_attack_rays & double_pawn_pushes;
-            }
-            // loop through target squares and encode in moves
 
-            captures = target_squares & occupancy[!for_side];
-            target_squares = target_squares & ~occupancy[!for_side];
+            // loop through target squares and encode in moves
+            target_squares &= target_filter;
             while (target_squares) {
                 // get and pop target square
-                target_square = get_ls1b_index(target_squares);
+                int target_square = get_ls1b_index(target_squares);
                 pop_bit(target_squares, target_square);
 
-                move = encode_move(pinned_square, target_square, (pinned_piece_type + for_side), 0, 0, 0, 0, 0, -1);
-                moves.push_back(move);
-            }
-            while (captures) {
-                // get and pop target square
-                target_square = get_ls1b_index(captures);
-                pop_bit(captures, target_square);
-
-                // get captured piece
-                int captured_piece = -1;
-                for (int piece_type = !for_side; piece_type < 10; piece_type += 2) {
-                    if (get_bit(piece_bitboards[piece_type], target_square)) {
-                        captured_piece = piece_type;
+                // get captured piece, the mailbox holds -1 on empty squares
+                int captured_piece = piece_on[target_square];
+                int capture = captured_piece != -1;
+
+                // a pinned pawn capturing the pinner on the last rank promotes
+                if (pinned_piece_type == pawn && ((1ULL << target_square) & (rank_1 | rank_8))) {
+                    for (int promote_type = 2 + for_side; promote_type < 10; promote_type += 2) {
+                        moves.push_back(encode_move(pinned_square, target_square, (pawn + for_side), promote_type,
+                                                    capture, 0, 0, 0, captured_piece));
                     }
+                } else {
+                    moves.push_back(encode_move(pinned_square, target_square, (pinned_piece_type + for_side), 0,
+                                                capture, 0, 0, 0, captured_piece));
                 }
+            }
+        }
+    }
+}
 
-                move = encode_move(pinned_square, target_square, (pinned_piece_type + for_side), 0, 1, 0, 0, 0,
-                                   captured_piece);
-                moves.push_back(move);
+/// work out the requested parts of the check info, the other parts are left alone
+/// \param info filled in
+/// \param occupancy_bitboards
+/// \param piece_bitboards
+/// \param for_side side to move
+/// \param parts CheckInfoParts flags of the parts to work out
+void init_check_info(CheckInfo &info, U64 occupancy_bitboards[3], U64 piece_bitboards[12], int for_side, int parts) {
+    if (parts & check_info_pins) {
+        info.king_square = get_ls1b_index(piece_bitboards[king + for_side]); // assuming only one king
+        info.opp_sliding_pieces[0] = piece_bitboards[bishop + !for_side] | piece_bitboards[queen + !for_side];
+        info.opp_sliding_pieces[1] = piece_bitboards[rook + !for_side] | piece_bitboards[queen + !for_side];
+        info.checkers = get_king_attackers(occupancy_bitboards, piece_bitboards, for_side);
+        info.num_checkers = count_bits(info.checkers);
+        info.pinned = get_pinned_pieces(info.king_square, for_side, info.opp_sliding_pieces, occupancy_bitboards);
+
+        // squares we can capture or push to, all squares unless we are in check
+        info.capture_mask = 0xFFFFFFFFFFFFFFFF;
+        info.push_mask = 0xFFFFFFFFFFFFFFFF;
+
+        // if there is only one attacker on the king, we have three options:
+        // 1. Move the king out of check
+        // 2. Capture the checking piece
+        // 3. Block the checking piece (if being checked by a rook, bishop or queen)
+        // in double check only king moves are legal, which the generator handles before looking at the masks
+        if (info.num_checkers == 1) {
+            // option 2, we can capture the checking piece
+            // (en passant out of check is tested separately by playing the capture out)
+            info.capture_mask = info.checkers;
+            int attacker_square = get_ls1b_index(info.checkers);
+
+            // if the checking piece is a slider
+            if (get_bit((info.opp_sliding_pieces[0] | info.opp_sliding_pieces[1]), attacker_square)) {
+                // option 3, we can block the checking piece
+                info.push_mask = opp_slider_rays_to_square(attacker_square, info.king_square,
+                                                           occupancy_bitboards[all]);
+            }
+                // if the checking piece is not a slider
+            else {
+                // we can't block it
+                info.push_mask = 0ULL; // empty bitboard
             }
         }
     }
-    return moves;
+
+    if (parts & check_info_king_danger) {
+        info.king_danger = get_king_danger_squares(occupancy_bitboards, piece_bitboards, for_side);
+    }
+
+    if (parts & check_info_check_squares) {
+        // where each of our pieces would attack the opponent's king from, by symmetry the squares it attacks
+        info.opp_king_square = get_ls1b_index(piece_bitboards[king + !for_side]);
+        U64 bishop_checks = get_bishop_attacks(info.opp_king_square, occupancy_bitboards[all]);
+        U64 rook_checks = get_rook_attacks(info.opp_king_square, occupancy_bitboards[all]);
+        info.check_squares[pawn / 2] = pawn_attacks[!for_side][info.opp_king_square];
+        info.check_squares[knight / 2] = knight_attacks[info.opp_king_square];
+        info.check_squares[bishop / 2] = bishop_checks;
+        info.check_squares[rook / 2] = rook_checks;
+        info.check_squares[queen / 2] = bishop_checks | rook_checks;
+        info.check_squares[king / 2] = 0ULL;
+
+        // our pieces standing alone between one of our sliders and the opponent's king, pins in the other direction
+        U64 our_sliding_pieces[2] = {piece_bitboards[bishop + for_side] | piece_bitboards[queen + for_side],
+                                     piece_bitboards[rook + for_side] | piece_bitboards[queen + for_side]};
+        info.discoverers = get_pinned_pieces(info.opp_king_square, for_side, our_sliding_pieces,
+                                             occupancy_bitboards);
+    }
 }
 
-/// get the legal moves in current position
+/// get the legal moves in current position for one side
+/// compiled once per side so pawn directions, castling squares and piece indices are all constants
+/// \param legal_moves list the legal moves are added to
+/// \param info check and pin info for the position, from init_check_info
 /// \param occupancy_bitboards
 /// \param piece_bitboards
-/// \param for_side
-/// \return
+/// \param piece_on piece on each square, -1 if empty
+/// \param castling_rights
+/// \param ep_sq
+/// \tparam for_side side to move
+/// \tparam gen_type GenType flags of the kinds of moves to add, the others are compiled out
 // reference https://peterellisjones.com/posts/generating-legal-chess-moves-efficiently/
-std::vector<int>
-generate_legal_moves(U64 occupancy_bitboards[3], U64 piece_bitboards[12], int for_side, int castling_rights,
-                     int ep_sq) {
+template<int for_side, int gen_type>
+static void generate_side_moves(MoveList &legal_moves, const CheckInfo &info, U64 occupancy_bitboards[3],
+                                U64 piece_bitboards[12], const int8_t piece_on[64], int castling_rights, int ep_sq) {
     // init variables
-    std::vector<int> legal_moves = {};
-    int move, source_square, target_square, capture, promoted, en_passant, captured_piece = -1;
-    U64 opp_sliding_pieces[2] = {(piece_bitboards[bishop + !for_side] | piece_bitboards[queen + !for_side]),
-                                 (piece_bitboards[rook + !for_side] | piece_bitboards[queen + !for_side])};
-    U64 friendly_sliding_pieces[2] = {(piece_bitboards[bishop + for_side] | piece_bitboards[queen + for_side]),
-                                      (piece_bitboards[rook + for_side] | piece_bitboards[queen + for_side])};
-    U64 king_danger_bitboard = get_king_danger_squares(occupancy_bitboards, piece_bitboards, for_side);
-    U64 king_attackers = get_king_attackers(occupancy_bitboards, piece_bitboards, for_side);
+    int move, source_square, target_square, capture, captured_piece = -1;
     U64 empty = ~occupancy_bitboards[all];
-    // squares we can capture or push to, init as all squares, narrowed when in check
-    U64 capture_mask = 0xFFFFFFFFFFFFFFFF;
-    U64 push_mask = 0xFFFFFFFFFFFFFFFF;
+    const bool captures = gen_type & gen_captures;
+    const bool promotions = gen_type & gen_promotions;
+    const bool quiets = gen_type & gen_quiets;
+    // evasions know the king is in check, so castling and pinned pieces can be skipped without testing
+    const bool evasions = (gen_type & gen_evasions) == gen_evasions;
+    // pseudo-legal moves skip the king danger, pin and en passant tests, is_legal does them per move instead
+    const bool legal = !(gen_type & gen_pseudo);
+    // squares the requested kinds of moves can land on (never our own pieces)
+    U64 target_filter = (captures ? occupancy_bitboards[!for_side] : 0ULL) | (quiets ? empty : 0ULL);
+    U64 capture_mask = info.capture_mask;
+    U64 push_mask = info.push_mask;
 
     // for en passant
     U64 ep_bb = 0ULL;
     if (ep_sq != no_sq)
         set_bit(ep_bb, ep_sq);
-    U64 all_pawn_attacks = 0ULL;
 
     // king (this assumes only one king on board)
-    source_square = get_ls1b_index(piece_bitboards[king + for_side]);
-    int king_square = source_square;
+    int king_square = info.king_square;
+    source_square = king_square;
     // get king moves by table lookup, only save those that aren't attacked or occupied by friendly pieces
-    U64 king_moves = king_attacks[source_square] & ~king_danger_bitboard & ~occupancy_bitboards[for_side];
+    U64 king_moves = king_attacks[source_square] & (legal ? ~info.king_danger : ~0ULL) & target_filter;
     while (king_moves) {
         // get target and pop
         target_square = get_ls1b_index(king_moves);
         pop_bit(king_moves, target_square);
-        // if it is a capture
-        if (get_bit(occupancy_bitboards[!for_side], target_square)) {
-            // get captured piece
-            for (int piece_type = !for_side; piece_type < 12; piece_type += 2) {
-                if (get_bit(piece_bitboards[piece_type], target_square)) {
-                    capture = 1;
-                    captured_piece = piece_type;
-                }
-            }
-        }
+        // get captured piece, the mailbox holds -1 on empty squares
+        captured_piece = piece_on[target_square];
+        capture = captured_piece != -1;
 
         move = encode_move(source_square, target_square, (king + for_side), 0, capture, 0, 0, 0, captured_piece);
         legal_moves.push_back(move);
@@ -774,140 +935,99 @@ generate_legal_moves(U64 occupancy_bitboards[3], U64 piece_bitboards[12], int fo
 
     // if the number of attackers on the king is > 1, we are in double check.
     // The only legal moves to get out of double check are king moves, so we can exit early
-    int num_king_attackers = count_bits(king_attackers);
-    if (num_king_attackers > 1) {
-        return legal_moves;
+    if (info.num_checkers > 1) {
+        return;
     }
-        // if there is only one attacker on the king, we have three options:
-        // 1. Move the king out of check (already calculated above)
-        // 2. Capture the checking piece
-        // 3. Block the checking piece (if being checked by a rook, bishop or queen)
-    else if (num_king_attackers == 1) {
-        // option 2, we can capture the checking piece
-        // if en passant is possible, and we are in check, then the pawn must be checking us.
-        capture_mask = king_attackers | ep_bb;
-        int attacker_square = get_ls1b_index(king_attackers);
-
-        // if the checking piece is a slider
-        if (get_bit((opp_sliding_pieces[0] | opp_sliding_pieces[1]), attacker_square)) {
-            // option 3, we can block the checking piece
-            push_mask = opp_slider_rays_to_square(attacker_square, source_square, occupancy_bitboards[all]);
-        }
-            // if the checking piece is not a slider
-        else {
-            // we can't block it
-            push_mask = 0ULL; // empty bitboard
-        }
-    }
-        // if king is not in check
-        //castling
-    else {
-        // white
-        if (!for_side) {
-            U64 opp_attacked_squares = attacked_squares(occupancy_bitboards, piece_bitboards, black);
-            // check castling rights
-            if (castling_rights & wk) {
-                // if the squares between rook and king are empty
-                if (!(castling_squares[0] & occupancy_bitboards[all])) {
-                    // if the squares that the king crosses are not attacked
-                    if (!(castling_squares[0] & opp_attacked_squares)) {
-                        // then castling kingside is legal
-                        move = encode_move(e1, g1, (king + for_side), 0, 0, 0, 0, 1, -1);
-                        legal_moves.push_back(move);
-                    }
-                }
-            }
-            // check castling rights
-            if (castling_rights & wq) {
-                // if the squares between rook and king are empty
-                if (!(castling_squares[1] & occupancy_bitboards[all])) {
-                    // if the squares that the king crosses are not attacked
-                    if (!(queenside_occupancy[0] & opp_attacked_squares)) {
-                        // then castling queenside is legal
-                        move = encode_move(e1, c1, (king + for_side), 0, 0, 0, 0, 1, -1);
-                        legal_moves.push_back(move);
-                    }
+
+    // if king is not in check
+    // castling, king danger squares are the same as the attacked squares when the king isn't in check
+    if (!evasions && !info.num_checkers && quiets) {
+        // our castling rights, squares and king square
+        const int kingside = for_side ? bk : wk;
+        const int queenside = for_side ? bq : wq;
+        const int king_from = for_side ? e8 : e1;
+
+        // check castling rights
+        if (castling_rights & kingside) {
+            // if the squares between rook and king are empty
+            if (!(castling_squares[2 * for_side] & occupancy_bitboards[all])) {
+                // if the squares that the king crosses are not attacked
+                if (!legal || !(castling_squares[2 * for_side] & info.king_danger)) {
+                    // then castling kingside is legal
+                    move = encode_move(king_from, king_from + 2, (king + for_side), 0, 0, 0, 0, 1, -1);
+                    legal_moves.push_back(move);
                 }
             }
         }
-            // black
-        else {
-            U64 opp_attacked_squares = attacked_squares(occupancy_bitboards, piece_bitboards, white);
-            // check castling rights
-            if (castling_rights & bk) {
-                // if the squares between rook and king are empty
-                if (!(castling_squares[2] & occupancy_bitboards[all])) {
-                    // if the squares that the king crosses are not attacked
-                    if (!(castling_squares[2] & opp_attacked_squares)) {
-                        // then castling kingside is legal
-                        move = encode_move(e8, g8, (king + for_side), 0, 0, 0, 0, 1, -1);
-                        legal_moves.push_back(move);
-                    }
-                }
-            }
-            // check castling rights
-            if (castling_rights & bq) {
-                // if the squares between rook and king are empty
-                if (!(queenside_occupancy[1] & occupancy_bitboards[all])) {
-                    // if the squares that the king crosses are not attacked
-                    if (!(castling_squares[3] & opp_attacked_squares)) {
-                        // then castling queenside is legal
-                        move = encode_move(e8, c8, (king + for_side), 0, 0, 0, 0, 1, -1);
-                        legal_moves.push_back(move);
-                    }
+        // check castling rights
+        if (castling_rights & queenside) {
+            // if the squares between rook and king are empty
+            if (!(queenside_occupancy[for_side] & occupancy_bitboards[all])) {
+                // if the squares that the king crosses are not attacked
+                if (!legal || !(castling_squares[2 * for_side + 1] & info.king_danger)) {
+                    // then castling queenside is legal
+                    move = encode_move(king_from, king_from - 2, (king + for_side), 0, 0, 0, 0, 1, -1);
+                    legal_moves.push_back(move);
                 }
             }
         }
     }
-    // calculate pinned pieces
-    U64 pinned_pieces = get_pinned_pieces(source_square, for_side, opp_sliding_pieces, occupancy_bitboards);
-    U64 non_pinned_pieces = occupancy_bitboards[for_side] & ~pinned_pieces;
-    std::vector<int> moves = get_pinned_moves(king_square, for_side, opp_sliding_pieces, piece_bitboards,
-                                              occupancy_bitboards, pinned_pieces, ep_bb);
-    legal_moves.insert(legal_moves.end(), moves.begin(), moves.end());
+    // pseudo-legal generation moves pinned pieces like any other
+    U64 non_pinned_pieces = occupancy_bitboards[for_side] & (legal ? ~info.pinned : ~0ULL);
+    // a pinned piece can never resolve a check, so pinned moves are only possible when not in check
+    if (legal && !evasions && !info.num_checkers) {
+        get_pinned_moves<for_side, gen_type>(legal_moves, king_square, info.opp_sliding_pieces, piece_bitboards,
+                                             piece_on, occupancy_bitboards, info.pinned, ep_bb);
+    }
     // moves for the rest of the pieces (non-king, non-pinned, while king not in check)
     // pawn pushes
     U64 pawns = piece_bitboards[pawn + for_side] & non_pinned_pieces;
-    U64 single_pawn_pushes = mask_single_pawn_pushes(for_side, pawns, empty);
-    U64 double_pawn_pushes = mask_double_pawn_pushes(for_side, single_pawn_pushes, empty);
-
-    // if king is in check, & with push mask to only allow moves that block check
-    single_pawn_pushes &= push_mask;
-    double_pawn_pushes &= push_mask;
-
-    while (single_pawn_pushes) {
-        // get target and source
-        target_square = get_ls1b_index(single_pawn_pushes);
-        U64 target_bb = 0ULL;
-        set_bit(target_bb, target_square);
-        source_square = for_side ? target_square - 8 : target_square + 8;
-        pop_bit(single_pawn_pushes, target_square);
-
-        // promotion
-        if (target_bb & (rank_1 | rank_8)) {
-            for (int promote_type = 2 + for_side; promote_type < 10; promote_type += 2) {
-                move = encode_move(source_square, target_square, (pawn + for_side), promote_type, 0, 0, 0, 0, -1);
+    if (promotions || quiets) {
+        U64 single_pawn_pushes = mask_single_pawn_pushes<for_side>(pawns, empty);
+        U64 double_pawn_pushes = quiets ? mask_double_pawn_pushes<for_side>(single_pawn_pushes, empty) : 0ULL;
+
+        // if king is in check, & with push mask to only allow moves that block check
+        single_pawn_pushes &= push_mask;
+        double_pawn_pushes &= push_mask;
+
+        // pushes to the last rank are promotions, the rest are quiet moves
+        if (!promotions) single_pawn_pushes &= ~(rank_1 | rank_8);
+        if (!quiets) single_pawn_pushes &= rank_1 | rank_8;
+
+        while (single_pawn_pushes) {
+            // get target and source
+            target_square = get_ls1b_index(single_pawn_pushes);
+            U64 target_bb = 0ULL;
+            set_bit(target_bb, target_square);
+            source_square = for_side ? target_square - 8 : target_square + 8;
+            pop_bit(single_pawn_pushes, target_square);
+
+            // promotion
+            if (target_bb & (rank_1 | rank_8)) {
+                for (int promote_type = 2 + for_side; promote_type < 10; promote_type += 2) {
+                    move = encode_move(source_square, target_square, (pawn + for_side), promote_type, 0, 0, 0, 0, -1);
+                    legal_moves.push_back(move);
+                }
+            } else {
+                move = encode_move(source_square, target_square, (pawn + for_side), 0, 0, 0, 0, 0, -1);
                 legal_moves.push_back(move);
             }
-        } else {
-            move = encode_move(source_square, target_square, (pawn + for_side), 0, 0, 0, 0, 0, -1);
-            legal_moves.push_back(move);
-        }
 
-    }
+        }
 
-    while (double_pawn_pushes) {
-        // get target and source
-        target_square = get_ls1b_index(double_pawn_pushes);
-        source_square = for_side ? target_square - 16 : target_square + 16;
-        pop_bit(double_pawn_pushes, target_square);
+        while (double_pawn_pushes) {
+            // get target and source
+            target_square = get_ls1b_index(double_pawn_pushes);
+            source_square = for_side ? target_square - 16 : target_square + 16;
+            pop_bit(double_pawn_pushes, target_square);
 
-        move = encode_move(source_square, target_square, (pawn + for_side), 0, 0, 1, 0, 0, -1);
-        legal_moves.push_back(move);
+            move = encode_move(source_square, target_square, (pawn + for_side), 0, 0, 1, 0, 0, -1);
+            legal_moves.push_back(move);
+        }
     }
 
     // pawn captures
-    while (pawns) {
+    while (captures && pawns) {
         // get source square then pop
         source_square = get_ls1b_index(pawns);
         pop_bit(pawns, source_square);
@@ -916,30 +1036,13 @@ generate_legal_moves(U64 occupancy_bitboards[3], U64 piece_bitboards[12], int fo
         U64 attacks = pawn_attacks[for_side][source_square] & capture_mask;
 
         // en passant
-        if (ep_bb & attacks & capture_mask) {
-            // get square of opp pawn being captured
-            target_square = for_side ? ep_sq - 8 : ep_sq + 8;
-            king_square = get_ls1b_index(piece_bitboards[king + for_side]);
-
-            // remove both pawns involved from the board
-            pop_bit(piece_bitboards[pawn + for_side], source_square);
-            pop_bit(piece_bitboards[pawn + !for_side], target_square);
-            pop_bit(occupancy_bitboards[for_side], source_square);
-            pop_bit(occupancy_bitboards[!for_side], target_square);
-
-            // check if the resulting position has the king in check
-            bool king_in_check = is_attacked(piece_bitboards, *occupancy_bitboards, king_square, !for_side);
-            // if not, en passant is legal
-            if (!king_in_check) {
-                move = encode_move(source_square, ep_sq, (pawn + for_side), 0, 1, 0, 1, 0, !for_side);
+        if (ep_bb & pawn_attacks[for_side][source_square]) {
+            // play the capture out to check it doesn't leave the king in check
+            if (!legal || is_legal_en_passant(piece_bitboards, occupancy_bitboards[all], king_square, source_square,
+                                              ep_sq, for_side)) {
+                move = encode_move(source_square, ep_sq, (pawn + for_side), 0, 1, 0, 1, 0, (pawn + !for_side));
                 legal_moves.push_back(move);
             }
-
-            // add both pawns involved back to the board
-            set_bit(piece_bitboards[pawn + for_side], source_square);
-            set_bit(piece_bitboards[pawn + !for_side], target_square);
-            set_bit(occupancy_bitboards[for_side], source_square);
-            set_bit(occupancy_bitboards[!for_side], target_square);
         }
 
         // for non-en passant, it must be a capture
@@ -952,18 +1055,13 @@ generate_legal_moves(U64 occupancy_bitboards[3], U64 piece_bitboards[12], int fo
             pop_bit(attacks, target_square);
 
             // get capture
-            capture = get_bit(occupancy_bitboards[!for_side], target_square) ? 1 : 0;
-            captured_piece = -1;
+            captured_piece = piece_on[target_square];
+            capture = captured_piece != -1;
             if (capture) {
                 // save move
                 // promotion
                 U64 target_bb = 0ULL;
                 set_bit(target_bb, target_square);
-                for (int piece_type = !for_side; piece_type < 10; piece_type += 2) {
-                    if (get_bit(piece_bitboards[piece_type], target_square)) {
-                        captured_piece = piece_type;
-                    }
-                }
 
                 if (target_bb & (rank_1 | rank_8)) {
                     for (int promote_type = 2 + for_side; promote_type < 10; promote_type += 2) {
@@ -981,6 +1079,11 @@ generate_legal_moves(U64 occupancy_bitboards[3], U64 piece_bitboards[12], int fo
         }
     }
 
+    // only captures and quiet moves are left, pieces don't promote
+    if (!captures && !quiets) {
+        return;
+    }
+
     // knights
     U64 knights = piece_bitboards[knight + for_side] & non_pinned_pieces;
     // loop through each knight on the board
@@ -989,8 +1092,8 @@ generate_legal_moves(U64 occupancy_bitboards[3], U64 piece_bitboards[12], int fo
         source_square = get_ls1b_index(knights);
         pop_bit(knights, source_square);
 
-        // use attack table lookup, & with friendly pieces to disallow self-capture
-        U64 attacks = knight_attacks[source_square] & ~occupancy_bitboards[for_side] & (push_mask | capture_mask);
+        // use attack table lookup, the target filter already disallows self-capture
+        U64 attacks = knight_attacks[source_square] & target_filter & (push_mask | capture_mask);
         // loop through attacked squares
         while (attacks) {
             // get target square
@@ -998,15 +1101,8 @@ generate_legal_moves(U64 occupancy_bitboards[3], U64 piece_bitboards[12], int fo
             pop_bit(attacks, target_square);
 
             // get capture
-            capture = get_bit(occupancy_bitboards[!for_side], target_square) ? 1 : 0;
-            captured_piece = -1;
-            if (capture) {
-                for (int piece_type = !for_side; piece_type < 10; piece_type += 2) {
-                    if (get_bit(piece_bitboards[piece_type], target_square)) {
-                        captured_piece = piece_type;
-                    }
-                }
-            }
+            captured_piece = piece_on[target_square];
+            capture = captured_piece != -1;
             // save move
             move = encode_move(source_square, target_square, (knight + for_side), 0, capture, 0, 0, 0, captured_piece);
             legal_moves.push_back(move);
@@ -1023,8 +1119,8 @@ generate_legal_moves(U64 occupancy_bitboards[3], U64 piece_bitboards[12], int fo
         source_square = get_ls1b_index(bishopsQueens);
         pop_bit(bishopsQueens, source_square);
 
-        // use attack table lookup, & with friendly pieces to disallow self-capture
-        U64 attacks = get_bishop_attacks(source_square, occupancy_bitboards[all]) & ~occupancy_bitboards[for_side] &
+        // use attack table lookup, the target filter already disallows self-capture
+        U64 attacks = get_bishop_attacks(source_square, occupancy_bitboards[all]) & target_filter &
                       (push_mask | capture_mask);
 
         // loop through attacked squares
@@ -1034,21 +1130,12 @@ generate_legal_moves(U64 occupancy_bitboards[3], U64 piece_bitboards[12], int fo
             pop_bit(attacks, target_square);
 
             // get capture
-            capture = get_bit(occupancy_bitboards[!for_side], target_square) ? 1 : 0;
-            captured_piece = -1;
-            if (capture) {
-                for (int piece_type = !for_side; piece_type < 10; piece_type += 2) {
-                    if (get_bit(piece_bitboards[piece_type], target_square)) {
-                        captured_piece = piece_type;
-                    }
-                }
-            }
-
-            // get piece (bishop or queen)
-            int piece = get_bit(piece_bitboards[bishop + for_side], source_square) ? bishop : queen;
+            captured_piece = piece_on[target_square];
+            capture = captured_piece != -1;
 
-            // save move
-            move = encode_move(source_square, target_square, (piece + for_side), 0, capture, 0, 0, 0, captured_piece);
+            // save move, piece is bishop or queen
+            move = encode_move(source_square, target_square, piece_on[source_square], 0, capture, 0, 0, 0,
+                               captured_piece);
             legal_moves.push_back(move);
         }
     }
@@ -1061,8 +1148,8 @@ generate_legal_moves(U64 occupancy_bitboards[3], U64 piece_bitboards[12], int fo
         source_square = get_ls1b_index(rooksQueens);
         pop_bit(rooksQueens, source_square);
 
-        // use attack table lookup, & with friendly pieces to disallow self-capture
-        U64 attacks = get_rook_attacks(source_square, occupancy_bitboards[all]) & ~occupancy_bitboards[for_side] &
+        // use attack table lookup, the target filter already disallows self-capture
+        U64 attacks = get_rook_attacks(source_square, occupancy_bitboards[all]) & target_filter &
                       (push_mask | capture_mask);
         // loop through attacked squares
         while (attacks) {
@@ -1071,25 +1158,303 @@ generate_legal_moves(U64 occupancy_bitboards[3], U64 piece_bitboards[12], int fo
             pop_bit(attacks, target_square);
 
             // get capture
-            capture = get_bit(occupancy_bitboards[!for_side], target_square) ? 1 : 0;
-            captured_piece = -1;
+            captured_piece = piece_on[target_square];
+            capture = captured_piece != -1;
 
-            if (capture) {
-                for (int piece_type = !for_side; piece_type < 10; piece_type += 2) {
-                    if (get_bit(piece_bitboards[piece_type], target_square)) {
-                        captured_piece = piece_type;
-                    }
-                }
+            // save move, piece is rook or queen
+            move = encode_move(source_square, target_square, piece_on[source_square], 0, capture, 0, 0, 0,
+                               captured_piece);
+            legal_moves.push_back(move);
+        }
+    }
+}
+
+/// get the legal moves in current position
+/// \param legal_moves list the legal moves are added to
+/// \param info check and pin info for the position, from init_check_info
+/// \param occupancy_bitboards
+/// \param piece_bitboards
+/// \param piece_on piece on each square, -1 if empty
+/// \param for_side
+/// \param castling_rights
+/// \param ep_sq
+/// \tparam gen_type GenType flags of the kinds of moves to add
+template<int gen_type>
+void generate_legal_moves(MoveList &legal_moves, const CheckInfo &info, U64 occupancy_bitboards[3],
+                          U64 piece_bitboards[12], const int8_t piece_on[64], int for_side, int castling_rights,
+                          int ep_sq) {
+    if (for_side == white) {
+        generate_side_moves<white, gen_type>(legal_moves, info, occupancy_bitboards, piece_bitboards, piece_on,
+                                             castling_rights, ep_sq);
+    } else {
+        generate_side_moves<black, gen_type>(legal_moves, info, occupancy_bitboards, piece_bitboards, piece_on,
+                                             castling_rights, ep_sq);
+    }
+}
+
+/// get all the legal moves in current position
+/// \param legal_moves list the legal moves are added to
+/// \param occupancy_bitboards
+/// \param piece_bitboards
+/// \param piece_on piece on each square, -1 if empty
+/// \param for_side
+/// \param castling_rights
+/// \param ep_sq
+void generate_legal_moves(MoveList &legal_moves, U64 occupancy_bitboards[3], U64 piece_bitboards[12],
+                          const int8_t piece_on[64], int for_side, int castling_rights, int ep_sq) {
+    CheckInfo info;
+    init_check_info(info, occupancy_bitboards, piece_bitboards, for_side);
+    if (info.num_checkers) {
+        generate_legal_moves<gen_evasions>(legal_moves, info, occupancy_bitboards, piece_bitboards, piece_on,
+                                           for_side, castling_rights, ep_sq);
+    } else {
+        generate_legal_moves<gen_all>(legal_moves, info, occupancy_bitboards, piece_bitboards, piece_on, for_side,
+                                      castling_rights, ep_sq);
+    }
+}
+
+// the specializations used outside this file
+#define INSTANTIATE_GENERATOR(gen_type) \
+    template void generate_legal_moves<gen_type>(MoveList &, const CheckInfo &, U64[3], U64[12], const int8_t[64], \
+                                                 int, int, int);
+
+INSTANTIATE_GENERATOR(gen_captures)
+INSTANTIATE_GENERATOR(gen_promotions)
+INSTANTIATE_GENERATOR(gen_quiets)
+INSTANTIATE_GENERATOR(gen_tactical)
+INSTANTIATE_GENERATOR(gen_all)
+INSTANTIATE_GENERATOR(gen_evasions)
+INSTANTIATE_GENERATOR(gen_captures | gen_pseudo)
+INSTANTIATE_GENERATOR(gen_promotions | gen_pseudo)
+INSTANTIATE_GENERATOR(gen_quiets | gen_pseudo)
+INSTANTIATE_GENERATOR(gen_tactical | gen_pseudo)
+INSTANTIATE_GENERATOR(gen_all | gen_pseudo)
+INSTANTIATE_GENERATOR(gen_evasions | gen_pseudo)
+
+#undef INSTANTIATE_GENERATOR
+
+/// get the pseudo-legal moves in current position, which still have to pass is_legal before being played
+/// moves that can never be legal (leaving a check unanswered, anything but king moves in double check,
+/// castling through occupied squares or out of check) are not generated
+/// \param moves list the moves are added to
+/// \param info check and pin info for the position, king danger squares aren't needed
+/// \param occupancy_bitboards
+/// \param piece_bitboards
+/// \param piece_on piece on each square, -1 if empty
+/// \param for_side
+/// \param castling_rights
+/// \param ep_sq
+void generate_pseudo_legal_moves(MoveList &moves, const CheckInfo &info, U64 occupancy_bitboards[3],
+                                 U64 piece_bitboards[12], const int8_t piece_on[64], int for_side,
+                                 int castling_rights, int ep_sq) {
+    if (info.num_checkers) {
+        generate_legal_moves<gen_evasions | gen_pseudo>(moves, info, occupancy_bitboards, piece_bitboards, piece_on,
+                                                        for_side, castling_rights, ep_sq);
+    } else {
+        generate_legal_moves<gen_all | gen_pseudo>(moves, info, occupancy_bitboards, piece_bitboards, piece_on,
+                                                   for_side, castling_rights, ep_sq);
+    }
+}
+
+/// check that a pseudo-legal move doesn't leave our king in check
+/// \param move pseudo-legal move in this position
+/// \param info check and pin info for the position, king danger squares aren't needed
+/// \param occupancy_bitboards
+/// \param piece_bitboards
+/// \param for_side side making the move
+/// \return bool true if the move is legal
+bool is_legal(int move, const CheckInfo &info, const U64 occupancy_bitboards[3], const U64 piece_bitboards[12],
+              int for_side) {
+    int source_square = get_move_source(move);
+    int target_square = get_move_target(move);
+
+    if (get_move_piece(move) == king + for_side) {
+        if (get_move_castling(move)) {
+            // the generator checked we aren't in check and the squares are empty,
+            // the king also can't cross an attacked square
+            int queenside = target_square < source_square;
+            U64 crossed = castling_squares[2 * for_side + queenside];
+            while (crossed) {
+                int square = get_ls1b_index(crossed);
+                pop_bit(crossed, square);
+                if (is_attacked(piece_bitboards, occupancy_bitboards[all], square, !for_side)) return false;
             }
+            return true;
+        }
+        // take the king off the board so it doesn't block a slider's ray to the square it steps back onto
+        U64 occupancy = occupancy_bitboards[all];
+        pop_bit(occupancy, source_square);
+        return !is_attacked(piece_bitboards, occupancy, target_square, !for_side);
+    }
 
-            // get piece (rook or queen)
-            int piece = get_bit(piece_bitboards[rook + for_side], source_square) ? rook : queen;
+    // en passant removes two pieces from the board at once, play it out
+    if (get_move_enpassant(move)) {
+        return is_legal_en_passant(piece_bitboards, occupancy_bitboards[all], info.king_square, source_square,
+                                   target_square, for_side);
+    }
 
-            // save move
-            move = encode_move(source_square, target_square, (piece + for_side), 0, capture, 0, 0, 0, captured_piece);
-            legal_moves.push_back(move);
+    // a pinned piece can only move along the line through it and our king
+    // (evasions were already generated to capture or block the checker)
+    return !get_bit(info.pinned, source_square) || get_bit(line[info.king_square][source_square], target_square);
+}
+
+/// check if a legal move gives check, directly or by uncovering one of our sliders
+/// \param move legal move in this position
+/// \param info check info for the position, only the check squares part is needed
+/// \param occupancy_bitboards
+/// \param piece_bitboards
+/// \param for_side side making the move
+/// \return bool true if the opponent will be in check after the move
+bool gives_check(int move, const CheckInfo &info, const U64 occupancy_bitboards[3], const U64 piece_bitboards[12],
+                 int for_side) {
+    int source_square = get_move_source(move);
+    int target_square = get_move_target(move);
+    int promoted = get_move_promoted(move);
+    int piece = promoted ? promoted : get_move_piece(move);
+
+    // direct check, the piece lands on a square it attacks the king from
+    // a promoting pawn has left its square, which might have been in the way
+    if (promoted) {
+        U64 occupancy = occupancy_bitboards[all];
+        pop_bit(occupancy, source_square);
+        U64 attacks;
+        if (piece == knight + for_side) {
+            attacks = knight_attacks[target_square];
+        } else if (piece == bishop + for_side) {
+            attacks = get_bishop_attacks(target_square, occupancy);
+        } else if (piece == rook + for_side) {
+            attacks = get_rook_attacks(target_square, occupancy);
+        } else {
+            attacks = get_queen_attacks(target_square, occupancy);
         }
+        if (get_bit(attacks, info.opp_king_square)) return true;
+    } else if (get_bit(info.check_squares[piece / 2], target_square)) {
+        return true;
+    }
+
+    // discovered check, the piece stepped off the line between one of our sliders and the king
+    if (get_bit(info.discoverers, source_square) &&
+        !get_bit(line[info.opp_king_square][source_square], target_square)) {
+        return true;
+    }
+
+    if (get_move_enpassant(move)) {
+        // both pawns leave their squares, either might uncover a slider
+        int captured_square = for_side ? target_square - 8 : target_square + 8;
+        U64 occupancy = occupancy_bitboards[all];
+        pop_bit(occupancy, source_square);
+        pop_bit(occupancy, captured_square);
+        set_bit(occupancy, target_square);
+        U64 bishopsQueens = piece_bitboards[bishop + for_side] | piece_bitboards[queen + for_side];
+        U64 rooksQueens = piece_bitboards[rook + for_side] | piece_bitboards[queen + for_side];
+        return (get_bishop_attacks(info.opp_king_square, occupancy) & bishopsQueens) ||
+               (get_rook_attacks(info.opp_king_square, occupancy) & rooksQueens);
+    }
+
+    if (get_move_castling(move)) {
+        // the rook might give check from its new square, with the king already moved past it
+        int queenside = target_square < source_square;
+        int rook_from = queenside ? source_square - 4 : source_square + 3;
+        int rook_to = queenside ? source_square - 1 : source_square + 1;
+        U64 occupancy = occupancy_bitboards[all];
+        pop_bit(occupancy, source_square);
+        pop_bit(occupancy, rook_from);
+        set_bit(occupancy, target_square);
+        set_bit(occupancy, rook_to);
+        return get_bit(get_rook_attacks(rook_to, occupancy), info.opp_king_square);
     }
-    return legal_moves;
+    return false;
 }
 
+/// get a bitboard of the pieces of both sides attacking a square
+/// sliders are looked up with the occupancy given rather than the board's, so pieces taken out of it
+/// uncover the sliders behind them
+/// https://www.chessprogramming.org/Square_Attacked_By#Any_Attacks
+/// \param square
+/// \param occupancy bitboard of occupied squares
+/// \param piece_bitboards
+/// \return U64 attackers, which can include pieces no longer in occupancy
+U64 attackers_to(int square, U64 occupancy, const U64 piece_bitboards[12]) {
+    U64 bishopsQueens = piece_bitboards[bishop] | piece_bitboards[bishop + black] | piece_bitboards[queen] |
+                        piece_bitboards[queen + black];
+    U64 rooksQueens = piece_bitboards[rook] | piece_bitboards[rook + black] | piece_bitboards[queen] |
+                      piece_bitboards[queen + black];
+
+    // a white pawn attacks the square if a black pawn on the square would attack it, and the other way around
+    return (pawn_attacks[black][square] & piece_bitboards[pawn]) |
+           (pawn_attacks[white][square] & piece_bitboards[pawn + black]) |
+           (knight_attacks[square] & (piece_bitboards[knight] | piece_bitboards[knight + black])) |
+           (king_attacks[square] & (piece_bitboards[king] | piece_bitboards[king + black])) |
+           (get_bishop_attacks(square, occupancy) & bishopsQueens) |
+           (get_rook_attacks(square, occupancy) & rooksQueens);
+}
+
+/// static exchange evaluation, the material a capture wins once both sides have recaptured on its target square
+/// with their least valuable attacker for as long as it pays, without searching
+/// each capture's gain goes in a swap list, which is then folded back from the end, where either side can stop
+/// recapturing instead, pins and recapturing promotions are not taken into account
+/// https://www.chessprogramming.org/SEE_-_The_Swap_Algorithm
+/// \param move legal move, for a quiet move it tells whether the piece can be won on its new square
+/// \param occupancy_bitboards
+/// \param piece_bitboards
+/// \param side side making the move
+/// \return int material won by side, in see_values, negative if the capture loses material
+int see(int move, const U64 occupancy_bitboards[3], const U64 piece_bitboards[12], int side) {
+    int source_square = get_move_source(move);
+    int target_square = get_move_target(move);
+    int promoted = get_move_promoted(move);
+
+    // at most 32 pieces can take part, one capture each
+    int gain[32];
+    int depth = 0;
+    gain[0] = get_move_capture(move) ? see_values[get_move_captured_piece(move) >> 1] : 0;
+    // value of the piece standing on the target square, the next one to be captured
+    int piece_value = see_values[(promoted ? promoted : get_move_piece(move)) >> 1];
+    if (promoted) gain[0] += piece_value - see_values[pawn / 2];
+
+    U64 occupancy = occupancy_bitboards[all];
+    pop_bit(occupancy, source_square);
+    if (get_move_enpassant(move)) pop_bit(occupancy, side ? target_square - 8 : target_square + 8);
+
+    U64 bishopsQueens = piece_bitboards[bishop] | piece_bitboards[bishop + black] | piece_bitboards[queen] |
+                        piece_bitboards[queen + black];
+    U64 rooksQueens = piece_bitboards[rook] | piece_bitboards[rook + black] | piece_bitboards[queen] |
+                      piece_bitboards[queen + black];
+    U64 attackers = attackers_to(target_square, occupancy, piece_bitboards) & occupancy;
+
+    for (int for_side = !side; ; for_side = !for_side) {
+        U64 our_attackers = attackers & occupancy_bitboards[for_side];
+        if (!our_attackers) break;
+
+        // least valuable attacker
+        int piece_type = pawn / 2;
+        U64 bitboard = 0ULL;
+        for (; piece_type <= king / 2; piece_type++) {
+            bitboard = our_attackers & piece_bitboards[piece_type * 2 + for_side];
+            if (bitboard) break;
+        }
+        // the king can't capture onto a square the other side still attacks
+        if (piece_type == king / 2 && (attackers & occupancy_bitboards[!for_side])) break;
+
+        depth++;
+        gain[depth] = piece_value - gain[depth - 1];
+        piece_value = see_values[piece_type];
+
+        // take the attacker off, which might uncover a slider behind it on the same line
+        pop_bit(occupancy, get_ls1b_index(bitboard));
+        if (piece_type == pawn / 2 || piece_type == bishop / 2 || piece_type == queen / 2) {
+            attackers |= get_bishop_attacks(target_square, occupancy) & bishopsQueens;
+        }
+        if (piece_type == rook / 2 || piece_type == queen / 2) {
+            attackers |= get_rook_attacks(target_square, occupancy) & rooksQueens;
+        }
+        attackers &= occupancy;
+    }
+
+    // each side recaptures only if it does better than stopping
+    while (depth > 0) {
+        gain[depth - 1] = -std::max(-gain[depth - 1], gain[depth]);
+        depth--;
+    }
+    return gain[0];
+}
@@ -6,116 +6,123 @@
 #define BITBOARDS_MOVEGENERATION_H
 
 #include "utils.h"
-#include "vector"
+#include <cstdint>
 
-// attacks masks
-static U64 bishop_masks[64];
-static U64 rook_masks[64];
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
-// pre-calculated attack tables for non-sliding pieces
-static U64 pawn_attacks[2][64]; // [color][square]
-static U64 knight_attacks[64]; // [square]
-static U64 king_attacks[64]; // [square]
 // pre-calculated attack tables for sliding pieces
-static U64 bishop_attacks[64][512]; // [square][occupancies]
-static U64 rook_attacks[64][4096]; // [square][occupancies]
-
-// relevant castling bitboards
-// squares to check if attacked
-// wk, wq, bk, bq
-static U64 castling_squares[4] = {0x6000000000000000, 0xc00000000000000, 0x000000000060, 0x00000000000c};
-// squares to check if occupied (only different for queenside, because b1/8 has to be empty, but can be attacked)
-static U64 queenside_occupancy[2] = {0xe00000000000000, 0x00000000000e};
-// how many bits a rook attacks from each square, not including edge squares
-
-
-static int rook_relevant_bits[64] = {12, 11, 11, 11, 11, 11, 11, 12, 11, 10, 10, 10, 10, 10, 10, 11, 11, 10, 10, 10, 10,
-                                     10, 10, 11, 11, 10, 10, 10, 10, 10, 10, 11, 11, 10, 10, 10, 10, 10, 10, 11, 11, 10,
-                                     10, 10, 10, 10, 10, 11, 11, 10, 10, 10, 10, 10, 10, 11, 12, 11, 11, 11, 11, 11, 11,
-                                     12};
-
-// how many bits a bishop attacks from each square, not including edge squares
-static int bishop_relevant_bits[64] = {6, 5, 5, 5, 5, 5, 5, 6, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 7, 7, 7, 7, 5, 5, 5, 5, 7,
-                                       9, 9, 7, 5, 5, 5, 5, 7, 9, 9, 7, 5, 5, 5, 5, 7, 7, 7, 7, 5, 5, 5, 5, 5, 5, 5, 5,
-                                       5, 5, 6, 5, 5, 5, 5, 5, 5, 6};
-
-// rook magic numbers
-// sourced from https://www.youtube.com/watch?v=UnEu5GOiSEs&list=PLmN0neTso3Jxh8ZIylk74JpwfiWNI76Cs&index=16
-static U64 rook_magic_nums[64] = {0x8a80104000800020ULL, 0x140002000100040ULL, 0x2801880a0017001ULL,
-                                  0x100081001000420ULL, 0x200020010080420ULL, 0x3001c0002010008ULL,
-                                  0x8480008002000100ULL, 0x2080088004402900ULL, 0x800098204000ULL,
-                                  0x2024401000200040ULL, 0x100802000801000ULL, 0x120800800801000ULL,
-                                  0x208808088000400ULL, 0x2802200800400ULL, 0x2200800100020080ULL, 0x801000060821100ULL,
-                                  0x80044006422000ULL, 0x100808020004000ULL, 0x12108a0010204200ULL,
-                                  0x140848010000802ULL, 0x481828014002800ULL, 0x8094004002004100ULL,
-                                  0x4010040010010802ULL, 0x20008806104ULL, 0x100400080208000ULL, 0x2040002120081000ULL,
-                                  0x21200680100081ULL, 0x20100080080080ULL, 0x2000a00200410ULL, 0x20080800400ULL,
-                                  0x80088400100102ULL, 0x80004600042881ULL, 0x4040008040800020ULL, 0x440003000200801ULL,
-                                  0x4200011004500ULL, 0x188020010100100ULL, 0x14800401802800ULL, 0x2080040080800200ULL,
-                                  0x124080204001001ULL, 0x200046502000484ULL, 0x480400080088020ULL,
-                                  0x1000422010034000ULL, 0x30200100110040ULL, 0x100021010009ULL, 0x2002080100110004ULL,
-                                  0x202008004008002ULL, 0x20020004010100ULL, 0x2048440040820001ULL,
-                                  0x101002200408200ULL, 0x40802000401080ULL, 0x4008142004410100ULL,
-                                  0x2060820c0120200ULL, 0x1001004080100ULL, 0x20c020080040080ULL, 0x2935610830022400ULL,
-                                  0x44440041009200ULL, 0x280001040802101ULL, 0x2100190040002085ULL,
-                                  0x80c0084100102001ULL, 0x4024081001000421ULL, 0x20030a0244872ULL, 0x12001008414402ULL,
-                                  0x2006104900a0804ULL, 0x1004081002402ULL};
-
-// bishop magic numbers
-static U64 bishop_magic_nums[64] = {0x40040844404084ULL, 0x2004208a004208ULL, 0x10190041080202ULL, 0x108060845042010ULL,
-                                    0x581104180800210ULL, 0x2112080446200010ULL, 0x1080820820060210ULL,
-                                    0x3c0808410220200ULL, 0x4050404440404ULL, 0x21001420088ULL, 0x24d0080801082102ULL,
-                                    0x1020a0a020400ULL, 0x40308200402ULL, 0x4011002100800ULL, 0x401484104104005ULL,
-                                    0x801010402020200ULL, 0x400210c3880100ULL, 0x404022024108200ULL,
-                                    0x810018200204102ULL, 0x4002801a02003ULL, 0x85040820080400ULL,
-                                    0x810102c808880400ULL, 0xe900410884800ULL, 0x8002020480840102ULL,
-                                    0x220200865090201ULL, 0x2010100a02021202ULL, 0x152048408022401ULL,
-                                    0x20080002081110ULL, 0x4001001021004000ULL, 0x800040400a011002ULL,
-                                    0xe4004081011002ULL, 0x1c004001012080ULL, 0x8004200962a00220ULL,
-                                    0x8422100208500202ULL, 0x2000402200300c08ULL, 0x8646020080080080ULL,
-                                    0x80020a0200100808ULL, 0x2010004880111000ULL, 0x623000a080011400ULL,
-                                    0x42008c0340209202ULL, 0x209188240001000ULL, 0x400408a884001800ULL,
-                                    0x110400a6080400ULL, 0x1840060a44020800ULL, 0x90080104000041ULL,
-                                    0x201011000808101ULL, 0x1a2208080504f080ULL, 0x8012020600211212ULL,
-                                    0x500861011240000ULL, 0x180806108200800ULL, 0x4000020e01040044ULL,
-                                    0x300000261044000aULL, 0x802241102020002ULL, 0x20906061210001ULL,
-                                    0x5a84841004010310ULL, 0x4010801011c04ULL, 0xa010109502200ULL, 0x4a02012000ULL,
-                                    0x500201010098b028ULL, 0x8040002811040900ULL, 0x28000010020204ULL,
-                                    0x6000020202d0240ULL, 0x8918844842082200ULL, 0x4010011029020020ULL};
-
-static inline int count_bits(U64 bitboard);
-
-static inline int get_ls1b_index(U64 bitboard);
+// "fancy" magics: each square only gets as many entries as its relevant occupancy bits need,
+// packed one after another and found through a per-square offset
+// https://www.chessprogramming.org/Magic_Bitboards#Fancy
+// the tables themselves are generated at compile time in MoveGeneration.cpp
+const int bishop_attacks_size = 5248;
+const int rook_attacks_size = 102400;
+
+// kinds of moves the generator can be asked for, combined as bit flags
+// captures include en passant and capturing promotions, promotions are the non-capturing ones
+// tactical moves are captures and promotions, what a quiescence search looks at
+// evasions are every kind of move, generated knowing the king is in check
+// adding gen_pseudo to any of them gives pseudo-legal moves, to be filtered with is_legal
+enum GenType {
+    gen_captures = 1, gen_promotions = 2, gen_quiets = 4, gen_tactical = 3, gen_all = 7, gen_in_check = 8,
+    gen_evasions = gen_all | gen_in_check, gen_pseudo = 16
+};
+
+// the king's safety in a position, everything the legal move generator needs to know before generating moves,
+// and the squares our moves would give check from
+// worked out once per position (Board caches it) so moves can be generated a few kinds at a time,
+// tested for legality and for giving check without repeating it
+struct CheckInfo {
+    // check_info_pins
+    int king_square;
+    U64 checkers; // opponent pieces giving check
+    int num_checkers;
+    U64 pinned; // our absolutely pinned pieces
+    U64 opp_sliding_pieces[2]; // bishopQueens, rookQueens
+    U64 capture_mask; // squares a non-king move must capture on, the checker when in check
+    U64 push_mask; // squares a non-king move must move to, the squares between the king and a checking slider
+
+    // check_info_king_danger, only needed for legal generation
+    U64 king_danger; // squares attacked by the opponent, seen through our king
+
+    // check_info_check_squares, only needed to tell if a move gives check
+    int opp_king_square;
+    U64 check_squares[6]; // [piece type] squares a piece of ours would check the opponent's king from
+    U64 discoverers; // our pieces that give a discovered check by moving off the line to the opponent's king
+};
+
+// parts of the check info, so each one is only worked out when something needs it
+enum CheckInfoParts {
+    check_info_pins = 1, check_info_king_danger = 2, check_info_check_squares = 4,
+    check_info_legal = check_info_pins | check_info_king_danger
+};
+
+// piece values for static exchange evaluation, by piece type
+// the king can only be the last piece to capture, so it just has to be worth more than everything else
+const int see_values[6] = {100, 300, 300, 500, 900, 10000};
+
+// count the number of bits in a bitboard
+static inline int count_bits(U64 bitboard) {
+#if defined(__GNUC__)
+    // compiles to a single popcnt instruction when the target has one
+    return __builtin_popcountll(bitboard);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    return (int) __popcnt64(bitboard);
+#else
+    int count = 0;
+
+    while (bitboard) {
+        count++;
+        bitboard &= bitboard - 1;  // reset least significant 1st bit
+    }
+    return count;
+#endif
+}
+
+// get least significant 1st bit (ls1b) index
+static inline int get_ls1b_index(U64 bitboard) {
+    if (bitboard) {
+#if defined(__GNUC__)
+        // count trailing zeros (tzcnt/bsf)
+        return __builtin_ctzll(bitboard);
+#elif defined(_MSC_VER) && defined(_M_X64)
+        unsigned long index;
+        _BitScanForward64(&index, bitboard);
+        return (int) index;
+#else
+        // count bits before ls1b
+        return count_bits((bitboard & -bitboard) - 1);
+#endif
+    } else {
+        return -1;
+    }
+}
 
 static inline U64 north_one(U64 bitboard);
 
 static inline U64 south_one(U64 bitboard);
 
-static U64 mask_pawn_attacks(int square, int side);
+static constexpr U64 mask_pawn_attacks(int square, int side);
 
-static U64 mask_single_pawn_pushes(int side, U64 pawns, U64 empty);
+template<int side>
+static U64 mask_single_pawn_pushes(U64 pawns, U64 empty);
 
-static U64 mask_double_pawn_pushes(int side, U64 single_pawn_pushes, U64 empty);
+template<int side>
+static U64 mask_double_pawn_pushes(U64 single_pawn_pushes, U64 empty);
 
-static U64 mask_knight_attacks(int square);
+static constexpr U64 mask_knight_attacks(int square);
 
-static U64 mask_king_attacks(int square);
+static constexpr U64 mask_king_attacks(int square);
 
-static U64 mask_rook_attacks(int square);
+static constexpr U64 mask_rook_attacks(int square);
 
-static U64 mask_bishop_attacks(int square);
+static constexpr U64 mask_bishop_attacks(int square);
 
-static U64 generate_rook_attacks(int square, U64 block);
+static constexpr U64 generate_rook_attacks(int square, U64 block);
 
-static U64 generate_bishop_attacks(int square, U64 block);
-
-static U64 set_occupancy(int index, int bits_in_mask, U64 attack_mask);
-
-static void generate_attack_tables_non_sliding();
-
-static void generate_attack_tables_sliding(int bishop);
-
-void fill_attack_tables();
+static constexpr U64 generate_bishop_attacks(int square, U64 block);
 
 static inline U64 get_bishop_attacks(int square, U64 occupancy);
 
@@ -127,13 +134,38 @@ static inline bool is_attacked(const U64 piece_bitboards[12], U64 occupancy, int
 
 U64 attacked_squares(const U64 occupancy_bitboards[3], const U64 piece_bitboards[12], int by_side);
 
-U64 get_pinned_pieces(int for_side, const U64 opp_slider_pieces[2], U64 occupancy[3]);
+U64 get_pinned_pieces(int king_square, int for_side, const U64 opp_slider_pieces[2], U64 occupancy[3]);
+
+template<int for_side, int gen_type>
+void get_pinned_moves(MoveList &moves, int king_square, const U64 opp_slider_pieces[2],
+                      const U64 piece_bitboards[12], const int8_t piece_on[64], const U64 occupancy[3],
+                      U64 pinned_pieces, U64 ep_bb);
+
+void init_check_info(CheckInfo &info, U64 occupancy_bitboards[3], U64 piece_bitboards[12], int for_side,
+                     int parts = check_info_legal);
+
+// compiled separately for each GenType, only gen_captures, gen_promotions, gen_quiets, gen_tactical, gen_all
+// and gen_evasions (which needs the side to move to be in check) are available, each with or without gen_pseudo
+template<int gen_type>
+void generate_legal_moves(MoveList &legal_moves, const CheckInfo &info, U64 occupancy_bitboards[3],
+                          U64 piece_bitboards[12], const int8_t piece_on[64], int side, int castling_rights,
+                          int ep_sq);
+
+void generate_legal_moves(MoveList &legal_moves, U64 occupancy_bitboards[3], U64 piece_bitboards[12],
+                          const int8_t piece_on[64], int side, int castling_rights, int ep_sq);
+
+void generate_pseudo_legal_moves(MoveList &moves, const CheckInfo &info, U64 occupancy_bitboards[3],
+                                 U64 piece_bitboards[12], const int8_t piece_on[64], int side, int castling_rights,
+                                 int ep_sq);
+
+bool is_legal(int move, const CheckInfo &info, const U64 occupancy_bitboards[3], const U64 piece_bitboards[12],
+              int side);
+
+bool gives_check(int move, const CheckInfo &info, const U64 occupancy_bitboards[3], const U64 piece_bitboards[12],
+                 int side);
 
-std::vector<int>
-get_pinned_moves(int king_square, int for_side, const U64 opp_slider_pieces[2], const U64 piece_bitboards[12],
-                 const U64 occupancy[3], U64 pinned_pieces, U64 ep_bb);
+U64 attackers_to(int square, U64 occupancy, const U64 piece_bitboards[12]);
 
-std::vector<int>
-generate_legal_moves(U64 occupancy_bitboards[3], U64 piece_bitboards[12], int side, int castling_rights, int ep_sq);
+int see(int move, const U64 occupancy_bitboards[3], const U64 piece_bitboards[12], int side);
 
 #endif //BITBOARDS_MOVEGENERATION_H
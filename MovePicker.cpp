@@ -0,0 +1,134 @@
+//
+// Created by Hayden Collins on 1/9/24.
+//
+
+#include "MovePicker.h"
+
+/// \param board position to pick moves in, must be back in the same position whenever next_move is called
+/// \param hash_move move to try first, usually from the transposition table, 0 for none
+/// \param killers num_killers quiet moves to try before the other quiets, nullptr for none
+/// \param history butterfly history to order the other quiets by, nullptr to leave them in generation order
+/// \param tactical only hand out captures that don't lose material and queen promotions
+MovePicker::MovePicker(Board &board, int hash_move, const int *killers, const ButterflyHistory *history,
+                       bool tactical)
+        : board(board), hash_move(hash_move), killers(killers), history(history), tactical(tactical) {
+    // a copy, the board's own one is thrown away as soon as a move is made
+    info = board.get_check_info();
+}
+
+/// generate a stage's moves the first time they are needed
+/// \param stage stage_captures, stage_promotions or stage_quiets
+/// \return MoveList& the stage's moves
+MoveList &MovePicker::generate_stage(int stage) {
+    int i = stage - stage_captures;
+    if (!generated[i]) {
+        if (stage == stage_captures) {
+            generate_legal_moves<gen_captures>(stage_moves[i], info, board.occupancy_bitboards, board.piece_bitboards,
+                                               board.piece_on, board.side_to_move, board.castling_rights,
+                                               board.enpassant_sq);
+        } else if (stage == stage_promotions) {
+            generate_legal_moves<gen_promotions>(stage_moves[i], info, board.occupancy_bitboards,
+                                                 board.piece_bitboards, board.piece_on, board.side_to_move,
+                                                 board.castling_rights, board.enpassant_sq);
+        } else {
+            generate_legal_moves<gen_quiets>(stage_moves[i], info, board.occupancy_bitboards, board.piece_bitboards,
+                                             board.piece_on, board.side_to_move, board.castling_rights,
+                                             board.enpassant_sq);
+        }
+        for (int j = 0; j < stage_moves[i].size(); j++) {
+            stage_scores[i][j] = score_move(stage, stage_moves[i][j]);
+        }
+        generated[i] = true;
+    }
+    return stage_moves[i];
+}
+
+/// score a move for ordering within its stage, higher goes first
+/// \param stage stage the move belongs to
+/// \param move
+/// \return int score
+int MovePicker::score_move(int stage, int move) const {
+    if (stage == stage_captures) {
+        // the victim counts for more than any attacker and any piece promoted to
+        int victim = get_move_captured_piece(move) >> 1, attacker = get_move_piece(move) >> 1;
+        int promoted = get_move_promoted(move) >> 1;
+        return victim * 16 + (king / 2 - attacker) + promoted;
+    } else if (stage == stage_promotions) {
+        return get_move_promoted(move) >> 1;
+    }
+    if (killers) {
+        for (int i = 0; i < num_killers; i++) {
+            if (move == killers[i]) return (1 << 30) - i;
+        }
+    }
+    return history ? (*history)[board.side_to_move][get_move_source(move)][get_move_target(move)] : 0;
+}
+
+/// check if a capture loses material once the exchange on its target square plays out
+/// \param move capture
+/// \return bool true if it does
+bool MovePicker::loses_material(int move) const {
+    // taking a piece worth at least as much as the one taking it can't lose material, whatever comes back
+    int victim = get_move_captured_piece(move) >> 1, attacker = get_move_piece(move) >> 1;
+    if (see_values[victim] >= see_values[attacker]) return false;
+    return board.see(move) < 0;
+}
+
+/// get the next move
+/// \return int move, or 0 once every legal move has been handed out
+int MovePicker::next_move() {
+    while (true) {
+        switch (stage) {
+            case stage_hash_move: {
+                stage++;
+                if (!hash_move) break;
+
+                // the hash move may come from a different position that shares the hash slot,
+                // so make sure it is legal here by generating the stage it belongs to (which is needed later anyway)
+                int hash_stage = get_move_capture(hash_move) ? stage_captures
+                                                             : get_move_promoted(hash_move) ? stage_promotions
+                                                                                            : stage_quiets;
+                MoveList &moves = generate_stage(hash_stage);
+                if (std::find(moves.begin(), moves.end(), hash_move) != moves.end()) {
+                    return hash_move;
+                }
+                hash_move = 0;
+                break;
+            }
+            case stage_captures:
+            case stage_promotions:
+            case stage_quiets: {
+                MoveList &moves = generate_stage(stage);
+                int *scores = stage_scores[stage - stage_captures];
+                while (index < moves.size()) {
+                    // selection sort one move at a time, a cutoff usually comes long before the end of the list
+                    int best = index;
+                    for (int i = index + 1; i < moves.size(); i++) {
+                        if (scores[i] > scores[best]) best = i;
+                    }
+                    std::swap(moves[index], moves[best]);
+                    std::swap(scores[index], scores[best]);
+                    int move = moves[index++];
+                    // already handed out as the hash move
+                    if (move == hash_move) continue;
+                    if (tactical && get_move_promoted(move) && get_move_promoted(move) >> 1 != queen / 2) continue;
+                    if (stage == stage_captures && loses_material(move)) {
+                        if (!tactical) bad_captures.push_back(move);
+                        continue;
+                    }
+                    return move;
+                }
+                // the tactical moves are all there are to a quiescence search
+                stage = tactical && stage == stage_promotions ? stage_done : stage + 1;
+                index = 0;
+                break;
+            }
+            case stage_bad_captures:
+                if (index < bad_captures.size()) return bad_captures[index++];
+                stage++;
+                break;
+            default:
+                return 0;
+        }
+    }
+}
@@ -0,0 +1,66 @@
+//
+// Created by Hayden Collins on 1/9/24.
+//
+
+#ifndef BITBOARDS_MOVEPICKER_H
+#define BITBOARDS_MOVEPICKER_H
+
+#include "Board.h"
+#include "MoveGeneration.h"
+
+// stages of the move picker, in the order their moves are handed out
+enum PickerStage {
+    stage_hash_move, stage_captures, stage_promotions, stage_quiets, stage_bad_captures, stage_done
+};
+
+// quiet moves that caused a beta cutoff at the same ply of the search, tried before other quiets
+// https://www.chessprogramming.org/Killer_Heuristic
+const int num_killers = 2;
+
+// butterfly history, [side][source][target] score of how often a quiet move has caused a beta cutoff
+// https://www.chessprogramming.org/History_Heuristic
+const int max_history = 16384;
+typedef int ButterflyHistory[2][64][64];
+
+// hands out the legal moves of a position one at a time, a stage at a time
+// each stage is only generated once the moves before it have been taken, so a search that cuts off
+// on the hash move or an early capture never pays for generating the quiet moves
+// within a stage the best scoring move left goes first: captures by most valuable victim then least valuable
+// attacker (MVV-LVA), promotions by the piece promoted to, quiets killers first and then by history
+// captures that lose material by static exchange evaluation are held back until after the quiets
+// a tactical picker, for the quiescence search, only hands out the captures that don't lose material and queen
+// promotions, and leaves out the rest
+// https://www.chessprogramming.org/Move_Generation#Staged_Move_Generation
+class MovePicker {
+public:
+    MovePicker(Board &board, int hash_move = 0, const int *killers = nullptr,
+               const ButterflyHistory *history = nullptr, bool tactical = false);
+
+    int next_move();
+
+    const CheckInfo &check_info() const { return info; }
+
+private:
+    MoveList &generate_stage(int stage);
+
+    int score_move(int stage, int move) const;
+
+    bool loses_material(int move) const;
+
+    Board &board;
+    CheckInfo info;
+    int hash_move; // 0 if there is none, or it turned out not to be legal here
+    const int *killers; // num_killers moves, or nullptr
+    const ButterflyHistory *history; // or nullptr
+    bool tactical;
+    int stage = stage_hash_move;
+    int index = 0; // next move to hand out in the current stage
+
+    // moves of the captures, promotions and quiets stages and their scores, generated on demand
+    MoveList stage_moves[3];
+    int stage_scores[3][max_moves];
+    bool generated[3] = {false, false, false};
+    MoveList bad_captures; // in the order they came up in the captures stage
+};
+
+#endif //BITBOARDS_MOVEPICKER_H
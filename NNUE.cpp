@@ -0,0 +1,280 @@
+//
+// Created by Hayden Collins on 1/18/24.
+//
+
+#include "NNUE.h"
+#include "Search.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+
+/// index of a piece on a square in one side's inputs
+/// black sees the board flipped with the colours swapped, so both sides share the same weights
+/// \param perspective side whose inputs these are
+/// \param piece
+/// \param square
+/// \return int input index
+static inline int feature_index(int perspective, int piece, int square) {
+    return perspective == white ? piece * 64 + square : (piece ^ 1) * 64 + (square ^ 56);
+}
+
+/// read the network from a weights file
+/// \param path
+/// \return std::unique_ptr<Network> the network, or nullptr if the file is missing or isn't a network of this shape
+std::unique_ptr<Network> load_network(const std::string &path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return nullptr;
+
+    char magic[4];
+    uint32_t header[4];
+    file.read(magic, sizeof(magic));
+    file.read(reinterpret_cast<char *>(header), sizeof(header));
+    if (!file || std::memcmp(magic, "BBNN", 4) != 0 || header[0] != nnue_version || header[1] != nnue_inputs ||
+        header[2] != nnue_accumulator_size || header[3] != nnue_hidden_size) {
+        return nullptr;
+    }
+
+    std::unique_ptr<Network> network(new Network);
+    file.read(reinterpret_cast<char *>(network->feature_weights), sizeof(network->feature_weights));
+    file.read(reinterpret_cast<char *>(network->feature_biases), sizeof(network->feature_biases));
+    // the file has a row of weights per neuron, regroup them into blocks of four inputs
+    std::vector<int8_t> rows(nnue_hidden_size * 2 * nnue_accumulator_size);
+    file.read(reinterpret_cast<char *>(rows.data()), rows.size());
+    for (int neuron = 0; neuron < nnue_hidden_size; neuron++) {
+        const int8_t *row = rows.data() + neuron * 2 * nnue_accumulator_size;
+        for (int input = 0; input < 2 * nnue_accumulator_size; input++) {
+            network->hidden_weights[input / 4][neuron * 4 + input % 4] = row[input];
+        }
+    }
+    file.read(reinterpret_cast<char *>(network->hidden_biases), sizeof(network->hidden_biases));
+    file.read(reinterpret_cast<char *>(network->output_weights), sizeof(network->output_weights));
+    file.read(reinterpret_cast<char *>(&network->output_bias), sizeof(network->output_bias));
+    // a short file is a broken one, and so is a longer one
+    if (!file || file.peek() != std::char_traits<char>::eof()) return nullptr;
+    return network;
+}
+
+/// work out the accumulators of a position from scratch, to start a search from
+/// \param board
+void AccumulatorStack::refresh(const Board &board) {
+    top = 0;
+    Accumulator &accumulator = stack[0];
+    for (int perspective = white; perspective <= black; perspective++) {
+        std::copy(network.feature_biases, network.feature_biases + nnue_accumulator_size,
+                  accumulator.values[perspective]);
+        for (int square = 0; square < 64; square++) {
+            int piece = board.piece_on[square];
+            if (piece < 0) continue;
+            const int16_t *weights = network.feature_weights[feature_index(perspective, piece, square)];
+            for (int i = 0; i < nnue_accumulator_size; i++) {
+                accumulator.values[perspective][i] += weights[i];
+            }
+        }
+    }
+}
+
+/// one side's accumulator after a move, the parent's with weight rows added for the pieces the move puts on
+/// squares and subtracted for the ones it takes off
+/// \param parent
+/// \param child
+/// \param added input rows to add
+/// \param num_added 1 or 2
+/// \param removed input rows to subtract
+/// \param num_removed 1 or 2
+static void update_accumulator(const int16_t *parent, int16_t *child, const int16_t *added[2], int num_added,
+                               const int16_t *removed[2], int num_removed) {
+#if defined(__AVX2__)
+    for (int i = 0; i < nnue_accumulator_size; i += 16) {
+        __m256i sum = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(parent + i));
+        for (int j = 0; j < num_added; j++) {
+            sum = _mm256_add_epi16(sum, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(added[j] + i)));
+        }
+        for (int j = 0; j < num_removed; j++) {
+            sum = _mm256_sub_epi16(sum, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(removed[j] + i)));
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(child + i), sum);
+    }
+#elif defined(__SSSE3__)
+    for (int i = 0; i < nnue_accumulator_size; i += 8) {
+        __m128i sum = _mm_loadu_si128(reinterpret_cast<const __m128i *>(parent + i));
+        for (int j = 0; j < num_added; j++) {
+            sum = _mm_add_epi16(sum, _mm_loadu_si128(reinterpret_cast<const __m128i *>(added[j] + i)));
+        }
+        for (int j = 0; j < num_removed; j++) {
+            sum = _mm_sub_epi16(sum, _mm_loadu_si128(reinterpret_cast<const __m128i *>(removed[j] + i)));
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(child + i), sum);
+    }
+#else
+    for (int i = 0; i < nnue_accumulator_size; i++) {
+        int16_t sum = parent[i];
+        for (int j = 0; j < num_added; j++) sum += added[j][i];
+        for (int j = 0; j < num_removed; j++) sum -= removed[j][i];
+        child[i] = sum;
+    }
+#endif
+}
+
+/// work out the accumulators after a move from the ones before it
+/// everything needed is in the move itself, so it can be called before or after Board::makeMove
+/// \param move
+void AccumulatorStack::push(int move) {
+    int source_square = get_move_source(move);
+    int target_square = get_move_target(move);
+    int piece = get_move_piece(move);
+    int promoted = get_move_promoted(move);
+    int side = piece & 1;
+
+    // pieces (piece, square) leaving and arriving, at most two of each
+    int removed_pieces[2][2], added_pieces[2][2];
+    int num_removed = 0, num_added = 0;
+    removed_pieces[num_removed][0] = piece;
+    removed_pieces[num_removed++][1] = source_square;
+    added_pieces[num_added][0] = promoted ? promoted : piece;
+    added_pieces[num_added++][1] = target_square;
+    if (get_move_capture(move)) {
+        // the pawn taken en passant is beside the target square, not on it
+        int captured_square = get_move_enpassant(move) ? (side == white ? target_square + 8 : target_square - 8)
+                                                       : target_square;
+        removed_pieces[num_removed][0] = get_move_captured_piece(move);
+        removed_pieces[num_removed++][1] = captured_square;
+    } else if (get_move_castling(move)) {
+        int kingside = target_square > source_square;
+        removed_pieces[num_removed][0] = rook + side;
+        removed_pieces[num_removed++][1] = kingside ? target_square + 1 : target_square - 2;
+        added_pieces[num_added][0] = rook + side;
+        added_pieces[num_added++][1] = kingside ? target_square - 1 : target_square + 1;
+    }
+
+    const Accumulator &parent = stack[top];
+    Accumulator &child = stack[++top];
+    for (int perspective = white; perspective <= black; perspective++) {
+        const int16_t *added[2], *removed[2];
+        for (int i = 0; i < num_added; i++) {
+            added[i] = network.feature_weights[feature_index(perspective, added_pieces[i][0], added_pieces[i][1])];
+        }
+        for (int i = 0; i < num_removed; i++) {
+            removed[i] = network.feature_weights[feature_index(perspective, removed_pieces[i][0],
+                                                               removed_pieces[i][1])];
+        }
+        update_accumulator(parent.values[perspective], child.values[perspective], added, num_added, removed,
+                           num_removed);
+    }
+}
+
+/// clip one side's accumulator to 0..127 into the hidden layer's input
+/// \param values
+/// \param output nnue_accumulator_size bytes
+static void clip_accumulator(const int16_t *values, uint8_t *output) {
+#if defined(__AVX2__)
+    const __m256i max = _mm256_set1_epi16(127);
+    for (int i = 0; i < nnue_accumulator_size; i += 32) {
+        __m256i low = _mm256_min_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(values + i)), max);
+        __m256i high = _mm256_min_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(values + i + 16)), max);
+        // packus clamps negatives to 0, but works within 128 bit lanes, so the quarters need putting back in order
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(low, high), 0xd8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(output + i), packed);
+    }
+#elif defined(__SSSE3__)
+    const __m128i max = _mm_set1_epi16(127);
+    for (int i = 0; i < nnue_accumulator_size; i += 16) {
+        __m128i low = _mm_min_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(values + i)), max);
+        __m128i high = _mm_min_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(values + i + 8)), max);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(output + i), _mm_packus_epi16(low, high));
+    }
+#else
+    for (int i = 0; i < nnue_accumulator_size; i++) {
+        output[i] = (uint8_t) std::min(std::max((int) values[i], 0), 127);
+    }
+#endif
+}
+
+/// the hidden layer's sums, before the bias
+/// each block of four inputs that isn't all zero is broadcast and multiplied against the block's weights for every
+/// neuron at once, clipping leaves many inputs at zero and their blocks are skipped
+/// the inputs are at most 127, so the pairwise sums of maddubs can't saturate and every path gives the same result
+/// \param input 2 * nnue_accumulator_size bytes
+/// \param weights Network::hidden_weights
+/// \param sums set to the sum of each hidden neuron
+static void hidden_layer(const uint8_t *input, const int8_t (*weights)[nnue_hidden_size * 4],
+                         int32_t sums[nnue_hidden_size]) {
+    int32_t blocks[nnue_input_blocks];
+    std::memcpy(blocks, input, sizeof(blocks));
+#if defined(__AVX2__)
+    const __m256i ones = _mm256_set1_epi16(1);
+    __m256i sum[nnue_hidden_size / 8];
+    for (__m256i &s: sum) s = _mm256_setzero_si256();
+    for (int i = 0; i < nnue_input_blocks; i += 8) {
+        // one bit for each of the next eight blocks that has a non zero input
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(blocks + i));
+        unsigned nonzero = ~_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(chunk, _mm256_setzero_si256())))
+                           & 0xff;
+        while (nonzero) {
+            int block = i + __builtin_ctz(nonzero);
+            nonzero &= nonzero - 1;
+            __m256i in = _mm256_set1_epi32(blocks[block]);
+            for (int j = 0; j < nnue_hidden_size / 8; j++) {
+                __m256i products = _mm256_maddubs_epi16(
+                        in, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(weights[block] + j * 32)));
+                sum[j] = _mm256_add_epi32(sum[j], _mm256_madd_epi16(products, ones));
+            }
+        }
+    }
+    for (int j = 0; j < nnue_hidden_size / 8; j++) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(sums + j * 8), sum[j]);
+    }
+#elif defined(__SSSE3__)
+    const __m128i ones = _mm_set1_epi16(1);
+    __m128i sum[nnue_hidden_size / 4];
+    for (__m128i &s: sum) s = _mm_setzero_si128();
+    for (int block = 0; block < nnue_input_blocks; block++) {
+        if (!blocks[block]) continue;
+        __m128i in = _mm_set1_epi32(blocks[block]);
+        for (int j = 0; j < nnue_hidden_size / 4; j++) {
+            __m128i products = _mm_maddubs_epi16(
+                    in, _mm_loadu_si128(reinterpret_cast<const __m128i *>(weights[block] + j * 16)));
+            sum[j] = _mm_add_epi32(sum[j], _mm_madd_epi16(products, ones));
+        }
+    }
+    for (int j = 0; j < nnue_hidden_size / 4; j++) {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(sums + j * 4), sum[j]);
+    }
+#else
+    std::fill(sums, sums + nnue_hidden_size, 0);
+    for (int block = 0; block < nnue_input_blocks; block++) {
+        if (!blocks[block]) continue;
+        const uint8_t *in = input + block * 4;
+        for (int neuron = 0; neuron < nnue_hidden_size; neuron++) {
+            const int8_t *w = weights[block] + neuron * 4;
+            sums[neuron] += in[0] * w[0] + in[1] * w[1] + in[2] * w[2] + in[3] * w[3];
+        }
+    }
+#endif
+}
+
+/// run the rest of the network on the current accumulators
+/// \param side_to_move
+/// \return int score in centipawns from the point of view of the side to move, never as big as a mate score
+int AccumulatorStack::evaluate(int side_to_move) const {
+    const Accumulator &accumulator = stack[top];
+    uint8_t input[2 * nnue_accumulator_size];
+    clip_accumulator(accumulator.values[side_to_move], input);
+    clip_accumulator(accumulator.values[!side_to_move], input + nnue_accumulator_size);
+
+    int32_t sums[nnue_hidden_size];
+    hidden_layer(input, network.hidden_weights, sums);
+
+    int32_t output = network.output_bias;
+    for (int i = 0; i < nnue_hidden_size; i++) {
+        int32_t hidden = (network.hidden_biases[i] + sums[i]) >> nnue_hidden_shift;
+        output += std::min(std::max(hidden, 0), 127) * network.output_weights[i];
+    }
+    // a big enough output would read as a mate to the search, which would then adjust it for the ply
+    return std::min(std::max(output / nnue_output_scale, -mate_bound + 1), mate_bound - 1);
+}
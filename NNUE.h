@@ -0,0 +1,78 @@
+//
+// Created by Hayden Collins on 1/18/24.
+//
+
+#ifndef BITBOARDS_NNUE_H
+#define BITBOARDS_NNUE_H
+
+#include "Board.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// efficiently updatable neural network evaluation
+// https://www.chessprogramming.org/NNUE
+//
+// 768 inputs, one per (piece, square) seen from each side, feed a 256 wide int16 accumulator per side
+// the two accumulators, side to move first, are clipped to 0..127 and feed an int8 dense layer of 32,
+// whose outputs are shifted down by nnue_hidden_shift, clipped to 0..127 and feed an int8 output neuron
+// the output divided by nnue_output_scale is the score in centipawns for the side to move
+const int nnue_inputs = 768;
+const int nnue_accumulator_size = 256;
+const int nnue_hidden_size = 32;
+const int nnue_hidden_shift = 6;
+const int nnue_output_scale = 16;
+
+// weights file layout, little endian, no padding
+// char magic[4] "BBNN", uint32 version, uint32 inputs, uint32 accumulator size, uint32 hidden size
+// int16 feature_weights[768][256], int16 feature_biases[256]
+// int8 hidden_weights[32][512], int32 hidden_biases[32]
+// int8 output_weights[32], int32 output_bias
+const uint32_t nnue_version = 1;
+
+// the hidden layer's inputs are taken four bytes at a time, so its weights are kept in blocks of
+// [input / 4][hidden neuron][input % 4] rather than the [neuron][input] of the file, and a block of four inputs
+// multiplies against one contiguous run of weights for every neuron
+const int nnue_input_blocks = 2 * nnue_accumulator_size / 4;
+
+// the network's weights, read only once loaded so every search thread can share one
+struct Network {
+    int16_t feature_weights[nnue_inputs][nnue_accumulator_size];
+    int16_t feature_biases[nnue_accumulator_size];
+    int8_t hidden_weights[nnue_input_blocks][nnue_hidden_size * 4];
+    int32_t hidden_biases[nnue_hidden_size];
+    int8_t output_weights[nnue_hidden_size];
+    int32_t output_bias;
+};
+
+std::unique_ptr<Network> load_network(const std::string &path);
+
+// first layer sums for both sides of one position, [side][neuron]
+struct Accumulator {
+    int16_t values[2][nnue_accumulator_size];
+};
+
+// accumulators of the positions along the line being searched, one per ply
+// a move only changes the inputs of the pieces it moves, takes or promotes, so each accumulator is its parent's
+// plus and minus a few weight rows instead of a sum over every piece
+// one per search thread, the network itself is shared
+class AccumulatorStack {
+public:
+    AccumulatorStack(const Network &network, int max_ply) : network(network), stack(max_ply + 1) {}
+
+    void refresh(const Board &board);
+
+    void push(int move);
+
+    void pop() { top--; }
+
+    int evaluate(int side_to_move) const;
+
+private:
+    const Network &network;
+    std::vector<Accumulator> stack; // [ply from where refresh was last called]
+    int top = 0;
+};
+
+#endif //BITBOARDS_NNUE_H
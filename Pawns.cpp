@@ -0,0 +1,148 @@
+//
+// Created by Hayden Collins on 1/16/24.
+//
+
+#include "Pawns.h"
+#include "Evaluation.h"
+
+// pawn structure terms, hand picked starting values rather than tuned ones
+static const int doubled_pawn = make_score(-11, -25);
+static const int isolated_pawn = make_score(-8, -14);
+static const int backward_pawn = make_score(-6, -10);
+// [rank from the pawn's own side] passed pawns are worth more the closer they are to promoting
+static const int passed_pawn[8] = {make_score(0, 0), make_score(2, 5), make_score(4, 10), make_score(8, 18),
+                                   make_score(15, 30), make_score(25, 50), make_score(40, 80), make_score(0, 0)};
+// [ranks in front of the king] own pawn directly in front of the king, one further up, or none on the file
+static const int shield_pawn[3] = {15, 8, -10};
+
+// masks for pawn structure, generated at compile time like the attack tables
+struct PawnMasks {
+    U64 files[8];
+    U64 adjacent_files[8];
+    U64 forward[2][64]; // [side][square] squares in front of a pawn on its own file
+    U64 passed[2][64]; // [side][square] squares in front of a pawn on its own and the adjacent files
+    U64 support[2][64]; // [side][square] squares on the adjacent files level with or behind a pawn
+};
+
+/// \return PawnMasks
+static constexpr PawnMasks init_pawn_masks() {
+    PawnMasks masks = {};
+    for (int file = 0; file < 8; file++) {
+        masks.files[file] = file_A << file;
+    }
+    for (int file = 0; file < 8; file++) {
+        masks.adjacent_files[file] = (file > 0 ? masks.files[file - 1] : 0ULL) |
+                                     (file < 7 ? masks.files[file + 1] : 0ULL);
+    }
+    for (int square = 0; square < 64; square++) {
+        int rank = square >> 3, file = square & 7; // rank 0 is the eighth rank
+        U64 three_files = masks.files[file] | masks.adjacent_files[file];
+        U64 above = 0ULL, below = 0ULL, level_and_below = 0ULL, level_and_above = 0ULL;
+        for (int r = 0; r < 8; r++) {
+            U64 rank_mask = 0xffULL << (r * 8);
+            if (r < rank) above |= rank_mask;
+            if (r > rank) below |= rank_mask;
+            if (r >= rank) level_and_below |= rank_mask;
+            if (r <= rank) level_and_above |= rank_mask;
+        }
+        // white pawns move towards rank 0, black pawns away from it
+        masks.forward[white][square] = masks.files[file] & above;
+        masks.forward[black][square] = masks.files[file] & below;
+        masks.passed[white][square] = three_files & above;
+        masks.passed[black][square] = three_files & below;
+        masks.support[white][square] = masks.adjacent_files[file] & level_and_below;
+        masks.support[black][square] = masks.adjacent_files[file] & level_and_above;
+    }
+    return masks;
+}
+
+static constexpr PawnMasks pawn_masks = init_pawn_masks();
+
+/// allocate the table
+/// \param size number of entries, a power of two
+PawnTable::PawnTable(int size) : entries(size), index_mask(size - 1) {}
+
+/// score one side's pawns and note its passed pawns and shields
+/// \param entry entry being filled in
+/// \param side
+/// \param own our pawns
+/// \param opp their pawns
+/// \param opp_attacks squares their pawns attack
+/// \return int packed score of our pawn structure
+static int score_pawns(PawnEntry &entry, int side, U64 own, U64 opp, U64 opp_attacks) {
+    int score = 0;
+    U64 pawns = own;
+    while (pawns) {
+        int square = get_ls1b_index(pawns);
+        pawns &= pawns - 1;
+        int file = square & 7;
+        int relative_rank = side == white ? 7 - (square >> 3) : square >> 3;
+        int stop_square = side == white ? square - 8 : square + 8;
+
+        bool doubled = own & pawn_masks.forward[side][square];
+        if (doubled) score += doubled_pawn;
+        if (!(own & pawn_masks.adjacent_files[file])) {
+            score += isolated_pawn;
+        } else if (!(own & pawn_masks.support[side][square]) && get_bit(opp_attacks, stop_square)) {
+            // no pawn of ours can come up beside it, and it can't advance without being taken
+            score += backward_pawn;
+        }
+        // a pawn behind one of our own isn't counted, the one in front is the passer
+        if (!doubled && !(opp & pawn_masks.passed[side][square])) {
+            score += passed_pawn[relative_rank];
+            set_bit(entry.passed[side], square);
+        }
+    }
+
+    // shelter for a king on each file, counting on the king being on its back rank
+    // each file's pawn is worth the same to every king next to it, so value the files once and add them in threes
+    int second_rank = side == white ? 6 : 1, third_rank = side == white ? 5 : 2;
+    int file_shield[10] = {}; // shifted by one, so the files either side of a and h are 0
+    for (int file = 0; file < 8; file++) {
+        if (get_bit(own, second_rank * 8 + file)) file_shield[file + 1] = shield_pawn[0];
+        else if (get_bit(own, third_rank * 8 + file)) file_shield[file + 1] = shield_pawn[1];
+        else if (!(own & pawn_masks.files[file])) file_shield[file + 1] = shield_pawn[2];
+    }
+    for (int king_file = 0; king_file < 8; king_file++) {
+        entry.shield[side][king_file] =
+                (int8_t) (file_shield[king_file] + file_shield[king_file + 1] + file_shield[king_file + 2]);
+    }
+    return score;
+}
+
+/// get the pawn structure of a position, analysing the pawns only if the table doesn't already have them
+/// \param board
+/// \return const PawnEntry& good until the next probe
+const PawnEntry &PawnTable::probe(const Board &board) {
+    probes++;
+    PawnEntry &entry = entries[board.pawn_key & index_mask];
+    if (entry.key == board.pawn_key) {
+        hits++;
+        return entry;
+    }
+
+    U64 white_pawns = board.piece_bitboards[pawn];
+    U64 black_pawns = board.piece_bitboards[pawn + 1];
+    U64 white_attacks = ((white_pawns >> 7) & not_A_file) | ((white_pawns >> 9) & not_H_file);
+    U64 black_attacks = ((black_pawns << 7) & not_H_file) | ((black_pawns << 9) & not_A_file);
+
+    entry.key = board.pawn_key;
+    entry.passed[white] = entry.passed[black] = 0ULL;
+    entry.score = score_pawns(entry, white, white_pawns, black_pawns, black_attacks) -
+                  score_pawns(entry, black, black_pawns, white_pawns, white_attacks);
+    return entry;
+}
+
+/// pawn structure score of a position, including the shelter of each king that is still on its back two ranks
+/// \param board
+/// \param table pawn table of the thread evaluating
+/// \return int packed score, white minus black
+int evaluate_pawns(const Board &board, PawnTable &table) {
+    const PawnEntry &entry = table.probe(board);
+    int score = entry.score;
+    int white_king = get_ls1b_index(board.piece_bitboards[king]);
+    int black_king = get_ls1b_index(board.piece_bitboards[king + 1]);
+    if (white_king >= a2) score += make_score(entry.shield[white][white_king & 7], 0);
+    if (black_king <= h7) score -= make_score(entry.shield[black][black_king & 7], 0);
+    return score;
+}
@@ -0,0 +1,42 @@
+//
+// Created by Hayden Collins on 1/16/24.
+//
+
+#ifndef BITBOARDS_PAWNS_H
+#define BITBOARDS_PAWNS_H
+
+#include "Board.h"
+#include <cstdint>
+#include <vector>
+
+// pawn structure of one position, worked out from the two pawn bitboards alone
+struct PawnEntry {
+    U64 key = 0ULL; // pawn key, 0 when empty, pawn keys start from pawn_key_seed so a pawnless one isn't 0 too
+    int score = 0; // doubled, isolated, backward and passed pawns, packed by make_score, white minus black
+    int8_t shield[2][8] = {}; // [side][king file] middlegame bonus for the pawns in front of a king on that file
+    U64 passed[2] = {0ULL, 0ULL}; // passed pawns of each side
+};
+
+// number of entries in a pawn table, a power of two
+// few pawn structures come up in one search, so a small table that stays in cache hits almost every time
+const int pawn_table_size = 16384;
+
+// cache of pawn structure keyed on the pawn key, one per search thread so it needs no locking
+// https://www.chessprogramming.org/Pawn_Hash_Table
+class PawnTable {
+public:
+    explicit PawnTable(int size = pawn_table_size);
+
+    const PawnEntry &probe(const Board &board);
+
+    U64 probes = 0;
+    U64 hits = 0;
+
+private:
+    std::vector<PawnEntry> entries;
+    U64 index_mask;
+};
+
+int evaluate_pawns(const Board &board, PawnTable &table);
+
+#endif //BITBOARDS_PAWNS_H
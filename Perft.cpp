@@ -0,0 +1,373 @@
+//
+// Created by Hayden Collins on 1/4/24.
+//
+
+#include "Perft.h"
+#include "MoveGeneration.h"
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+/// allocate the table with the largest power of two number of entries that fits in size_mb
+/// \param size_mb table size in megabytes
+PerftTable::PerftTable(size_t size_mb) {
+    size_t max_entries = (size_mb * 1024 * 1024) / sizeof(PerftEntry);
+    size_t num_entries = 1;
+    while (num_entries * 2 <= max_entries) {
+        num_entries *= 2;
+    }
+    entries.resize(num_entries);
+    index_mask = num_entries - 1;
+}
+
+/// look up the node count of a position at a given depth
+/// \param key zobrist key of the position
+/// \param depth
+/// \param nodes set to the stored node count on a hit
+/// \return bool true if the table held this position and depth
+bool PerftTable::probe(U64 key, int depth, U64 &nodes) {
+    probes++;
+    const PerftEntry &entry = entries[key & index_mask];
+    if (entry.key == key && (int) (entry.data & 0xff) == depth) {
+        hits++;
+        nodes = entry.data >> 8;
+        return true;
+    }
+    return false;
+}
+
+/// store the node count of a position at a given depth, always replacing the old entry
+/// \param key zobrist key of the position
+/// \param depth
+/// \param nodes
+void PerftTable::store(U64 key, int depth, U64 nodes) {
+    PerftEntry &entry = entries[key & index_mask];
+    entry.key = key;
+    entry.data = (nodes << 8) | (U64) depth;
+}
+
+/// empty the table and reset the hit counters
+void PerftTable::clear() {
+    std::fill(entries.begin(), entries.end(), PerftEntry());
+    probes = 0;
+    hits = 0;
+}
+
+/// count leaf nodes, along with the captures, en passants, castles and promotions played on the way to them
+/// \param depth
+/// \param board
+/// \param captures
+/// \param ep
+/// \param castles
+/// \param promotions
+/// \return U64 number of leaf nodes
+U64 perft(int depth, Board &board, int &captures, int &ep, int &castles, int &promotions) {
+    if (depth == 0) {
+        return 1ULL;
+    }
+    U64 nodes = 0;
+
+    MoveList legal_moves = board.get_legal_moves();
+    for (int move: legal_moves) {
+        if (get_move_capture(move)) captures++;
+        if (get_move_enpassant(move)) ep++;
+        if (get_move_castling(move)) castles++;
+        if (get_move_promoted(move)) promotions++;
+        board.makeMove(move);
+        nodes += perft(depth - 1, board, captures, ep, castles, promotions);
+        board.undoMove(move);
+    }
+    return nodes;
+}
+
+/// count leaf nodes only
+/// \param depth
+/// \param board
+/// \param bulk count the legal moves at depth 1 instead of playing each one out
+/// \return U64 number of leaf nodes
+U64 perft_nodes(int depth, Board &board, bool bulk) {
+    if (depth == 0) {
+        return 1ULL;
+    }
+    U64 nodes = 0;
+
+    MoveList legal_moves = board.get_legal_moves();
+    // bulk counting, every legal move at the last ply is exactly one leaf
+    // https://www.chessprogramming.org/Perft#Bulk-counting
+    if (bulk && depth == 1) {
+        return (U64) legal_moves.size();
+    }
+    for (int move: legal_moves) {
+        board.makeMove(move);
+        nodes += perft_nodes(depth - 1, board, bulk);
+        board.undoMove(move);
+    }
+    return nodes;
+}
+
+/// count leaf nodes with pseudo-legal generation, testing each move with is_legal before playing it
+/// perft has to test every move, so this measures the cost of the two approaches with no cutoffs to help either
+/// \param depth
+/// \param board
+/// \param bulk count the legal moves at depth 1 instead of playing each one out
+/// \return U64 number of leaf nodes
+U64 perft_pseudo_legal(int depth, Board &board, bool bulk) {
+    if (depth == 0) {
+        return 1ULL;
+    }
+    U64 nodes = 0;
+
+    // a copy, the board's own one is thrown away as soon as a move is made
+    CheckInfo info = board.get_check_info(check_info_pins);
+    MoveList moves;
+    generate_pseudo_legal_moves(moves, info, board.occupancy_bitboards, board.piece_bitboards, board.piece_on,
+                                board.side_to_move, board.castling_rights, board.enpassant_sq);
+    for (int move: moves) {
+        if (!is_legal(move, info, board.occupancy_bitboards, board.piece_bitboards, board.side_to_move)) continue;
+        if (bulk && depth == 1) {
+            nodes++;
+            continue;
+        }
+        board.makeMove(move);
+        nodes += perft_pseudo_legal(depth - 1, board, bulk);
+        board.undoMove(move);
+    }
+    return nodes;
+}
+
+/// perft that looks up subtrees reached by transposition instead of walking them again
+/// \param depth
+/// \param board
+/// \param table
+/// \param bulk count the legal moves at depth 1 instead of playing each one out
+/// \return U64 number of leaf nodes
+U64 perft_hashed(int depth, Board &board, PerftTable &table, bool bulk) {
+    if (depth == 0) {
+        return 1ULL;
+    }
+    if (bulk && depth == 1) {
+        // cheaper to generate the moves than to probe the table
+        return (U64) board.get_legal_moves().size();
+    }
+    U64 nodes = 0;
+
+    if (table.probe(board.hash_key, depth, nodes)) {
+        return nodes;
+    }
+
+    MoveList legal_moves = board.get_legal_moves();
+    for (int move: legal_moves) {
+        board.makeMove(move);
+        nodes += perft_hashed(depth - 1, board, table, bulk);
+        board.undoMove(move);
+    }
+
+    table.store(board.hash_key, depth, nodes);
+    return nodes;
+}
+
+/// run perft to each depth up to max_depth
+/// full mode also counts captures, en passants, castles and promotions, bulk mode only counts nodes but reports nps
+/// \param max_depth
+/// \param fen
+/// \param board
+/// \param bulk use bulk counting at the leaves
+void run_perft(int max_depth, std::string fen, Board &board, bool bulk) {
+    board.load_FEN(fen);
+    for (int depth = 1; depth <= max_depth; depth++) {
+        if (bulk) {
+            auto start = std::chrono::steady_clock::now();
+            U64 nodes = perft_nodes(depth, board, true);
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+            double nps = elapsed.count() > 0 ? (double) nodes / elapsed.count() : 0.0;
+            printf("nodes at depth %d = %llu, time = %.3fs, nps = %.0f\n", depth, nodes, elapsed.count(), nps);
+            continue;
+        }
+        int captures = 0, ep = 0, castles = 0, promotions = 0;
+        U64 nodes = perft(depth, board, captures, ep, castles, promotions);
+        printf("nodes at depth %d = %llu, captures = %d, ep = %d, castles = %d, promotions = %d\n", depth, nodes,
+               captures, ep, castles, promotions);
+    }
+}
+
+/// run hashed perft to each depth up to max_depth, reporting hit rate and nodes per second
+/// \param max_depth
+/// \param fen
+/// \param board
+/// \param table_mb size of the transposition table in megabytes
+/// \param bulk use bulk counting at the leaves
+void run_perft_hashed(int max_depth, std::string fen, Board &board, size_t table_mb, bool bulk) {
+    board.load_FEN(fen);
+    PerftTable table(table_mb);
+    printf("perft table: %zu entries (%zu MB)\n", table.size(), table_mb);
+
+    for (int depth = 1; depth <= max_depth; depth++) {
+        U64 probes = table.probes, hits = table.hits;
+
+        auto start = std::chrono::steady_clock::now();
+        U64 nodes = perft_hashed(depth, board, table, bulk);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        probes = table.probes - probes;
+        hits = table.hits - hits;
+        double hit_rate = probes ? 100.0 * (double) hits / (double) probes : 0.0;
+        double nps = elapsed.count() > 0 ? (double) nodes / elapsed.count() : 0.0;
+        printf("nodes at depth %d = %llu, hit rate = %.2f%%, time = %.3fs, nps = %.0f\n", depth, nodes, hit_rate,
+               elapsed.count(), nps);
+    }
+}
+
+// queue of perft tasks dealt to one worker before the search starts, other workers take from its front once
+// their own is empty, tasks are never split further once dealt
+struct PerftQueue {
+    std::mutex lock;
+    std::deque<PerftTask *> tasks;
+};
+
+/// expand the tree split_depth plies below the root into tasks
+/// \param board
+/// \param plies plies left to expand
+/// \param task task being built, holds the moves played so far
+/// \param tasks
+static void split_perft_tasks(Board &board, int plies, PerftTask &task, std::vector<PerftTask> &tasks) {
+    if (plies == 0) {
+        tasks.push_back(task);
+        return;
+    }
+
+    MoveList legal_moves = board.get_legal_moves();
+    for (int move: legal_moves) {
+        task.moves[task.num_moves++] = move;
+        board.makeMove(move);
+        split_perft_tasks(board, plies - 1, task, tasks);
+        board.undoMove(move);
+        task.num_moves--;
+    }
+}
+
+/// take a task from the back of our own queue, or steal one from the front of another worker's queue
+/// \param queues
+/// \param worker_id
+/// \return PerftTask* or nullptr once every queue is empty
+static PerftTask *get_perft_task(std::vector<PerftQueue> &queues, int worker_id) {
+    int num_queues = (int) queues.size();
+    for (int i = 0; i < num_queues; i++) {
+        int queue_id = (worker_id + i) % num_queues;
+        PerftQueue &queue = queues[queue_id];
+        std::lock_guard<std::mutex> guard(queue.lock);
+        if (queue.tasks.empty()) continue;
+
+        PerftTask *task;
+        if (queue_id == worker_id) {
+            task = queue.tasks.back();
+            queue.tasks.pop_back();
+        } else {
+            task = queue.tasks.front();
+            queue.tasks.pop_front();
+        }
+        return task;
+    }
+    return nullptr;
+}
+
+/// worker loop, plays out tasks on its own copy of the board until there is no work left to steal
+/// \param board copy of the root position owned by this worker
+/// \param depth total perft depth
+/// \param bulk use bulk counting at the leaves
+/// \param queues
+/// \param worker_id
+static void perft_worker(Board board, int depth, bool bulk, std::vector<PerftQueue> &queues, int worker_id) {
+    PerftTask *task;
+    while ((task = get_perft_task(queues, worker_id)) != nullptr) {
+        for (int i = 0; i < task->num_moves; i++) {
+            board.makeMove(task->moves[i]);
+        }
+        task->nodes = perft_nodes(depth - task->num_moves, board, bulk);
+        for (int i = task->num_moves - 1; i >= 0; i--) {
+            board.undoMove(task->moves[i]);
+        }
+    }
+}
+
+/// perft split into subtrees at split_depth plies below the root, searched by num_threads workers
+/// a static task pool with stealing: the subtrees are all made up front and dealt round robin, and a worker that
+/// runs out takes queued subtrees from the others, but a subtree already being searched is never split again,
+/// so one subtree much bigger than the rest still leaves the other workers idle at the end
+/// \param depth
+/// \param board
+/// \param num_threads
+/// \param split_depth plies below the root to split the tree at
+/// \param root_moves filled with the legal moves at the root
+/// \param divide_counts filled with the node count below each root move
+/// \param bulk use bulk counting at the leaves
+/// \return U64 number of leaf nodes
+U64 perft_parallel(int depth, Board &board, int num_threads, int split_depth, MoveList &root_moves,
+                   std::vector<U64> &divide_counts, bool bulk) {
+    root_moves = board.get_legal_moves();
+    divide_counts.assign(root_moves.size(), 0ULL);
+    if (depth == 0) {
+        return 1ULL;
+    }
+    split_depth = std::max(1, std::min(std::min(split_depth, depth), max_split_depth));
+    num_threads = std::max(1, num_threads);
+
+    // build the tasks under each root move
+    std::vector<PerftTask> tasks;
+    for (int i = 0; i < root_moves.size(); i++) {
+        PerftTask task;
+        task.root_index = i;
+        task.moves[task.num_moves++] = root_moves[i];
+        board.makeMove(root_moves[i]);
+        split_perft_tasks(board, split_depth - 1, task, tasks);
+        board.undoMove(root_moves[i]);
+    }
+
+    // deal the tasks out round robin
+    std::vector<PerftQueue> queues(num_threads);
+    for (int i = 0; i < (int) tasks.size(); i++) {
+        queues[i % num_threads].tasks.push_back(&tasks[i]);
+    }
+
+    std::vector<std::thread> workers;
+    for (int worker_id = 1; worker_id < num_threads; worker_id++) {
+        workers.emplace_back(perft_worker, board, depth, bulk, std::ref(queues), worker_id);
+    }
+    perft_worker(board, depth, bulk, queues, 0);
+    for (std::thread &worker: workers) {
+        worker.join();
+    }
+
+    // add up the subtrees
+    U64 nodes = 0;
+    for (const PerftTask &task: tasks) {
+        divide_counts[task.root_index] += task.nodes;
+        nodes += task.nodes;
+    }
+    return nodes;
+}
+
+/// run a parallel perft and print the divide counts for each root move
+/// \param depth
+/// \param fen
+/// \param board
+/// \param num_threads
+/// \param bulk use bulk counting at the leaves
+void run_perft_parallel(int depth, std::string fen, Board &board, int num_threads, bool bulk) {
+    board.load_FEN(fen);
+    MoveList root_moves;
+    std::vector<U64> divide_counts;
+
+    auto start = std::chrono::steady_clock::now();
+    // split two plies down so there are a few hundred tasks to balance between workers
+    U64 nodes = perft_parallel(depth, board, num_threads, 2, root_moves, divide_counts, bulk);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    for (int i = 0; i < root_moves.size(); i++) {
+        printf("%s: %llu\n", move_to_string(root_moves[i]).c_str(), divide_counts[i]);
+    }
+    double nps = elapsed.count() > 0 ? (double) nodes / elapsed.count() : 0.0;
+    printf("\nnodes at depth %d = %llu, threads = %d, time = %.3fs, nps = %.0f\n", depth, nodes, num_threads,
+           elapsed.count(), nps);
+}
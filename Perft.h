@@ -0,0 +1,70 @@
+//
+// Created by Hayden Collins on 1/4/24.
+//
+
+#ifndef BITBOARDS_PERFT_H
+#define BITBOARDS_PERFT_H
+
+#include "Board.h"
+#include <string>
+#include <vector>
+
+// entry in the perft transposition table
+// depth is packed into the low 8 bits of data and the node count into the high 56
+struct PerftEntry {
+    U64 key = 0ULL;
+    U64 data = 0ULL;
+};
+
+// fixed size table of perft node counts keyed on position hash and depth
+// https://www.chessprogramming.org/Perft#Hashing
+class PerftTable {
+public:
+    explicit PerftTable(size_t size_mb);
+
+    bool probe(U64 key, int depth, U64 &nodes);
+
+    void store(U64 key, int depth, U64 nodes);
+
+    void clear();
+
+    size_t size() const { return entries.size(); }
+
+    U64 probes = 0;
+    U64 hits = 0;
+
+private:
+    std::vector<PerftEntry> entries;
+    U64 index_mask;
+};
+
+// a subtree of a parallel perft, the moves leading to it from the root and the depth left to search
+const int max_split_depth = 4;
+
+struct PerftTask {
+    int moves[max_split_depth];
+    int num_moves = 0;
+    int root_index = 0; // index of the root move this subtree belongs to, for divide counts
+    U64 nodes = 0;
+};
+
+U64 perft(int depth, Board &board, int &captures, int &ep, int &castles, int &promotions);
+
+// bulk counting returns the number of legal moves at depth 1 instead of making and unmaking each of them,
+// full mode walks every leaf and so also exercises Board::makeMove/undoMove
+U64 perft_nodes(int depth, Board &board, bool bulk = false);
+
+U64 perft_pseudo_legal(int depth, Board &board, bool bulk = false);
+
+U64 perft_parallel(int depth, Board &board, int num_threads, int split_depth, MoveList &root_moves,
+                   std::vector<U64> &divide_counts, bool bulk = false);
+
+U64 perft_hashed(int depth, Board &board, PerftTable &table, bool bulk = false);
+
+void run_perft(int max_depth, std::string fen, Board &board, bool bulk = false);
+
+void run_perft_hashed(int max_depth, std::string fen, Board &board, size_t table_mb, bool bulk = false);
+
+void run_perft_parallel(int depth, std::string fen, Board &board, int num_threads, bool bulk = false);
+
+#endif //BITBOARDS_PERFT_H
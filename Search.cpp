@@ -0,0 +1,449 @@
+//
+// Created by Hayden Collins on 1/12/24.
+//
+
+#include "Search.h"
+#include "Evaluation.h"
+#include "MovePicker.h"
+#include "Pawns.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// most a quiet position can gain positionally on top of the material a capture wins, for delta pruning
+const int delta_margin = 200;
+
+// what every thread of one search shares, its limits, the table and the signal to stop
+struct SharedSearch {
+    SharedSearch(const SearchLimits &limits, TranspositionTable &table) : limits(limits), table(table) {}
+
+    const SearchLimits &limits;
+    TranspositionTable &table;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::atomic<bool> stop{false}; // set by the main thread, every thread finishes its search soon after
+    std::atomic<U64> nodes{0}; // nodes of every thread, each one adds its count every so often
+};
+
+// one thread's search, with its own copy of the board, evaluation state and principal variation table
+struct SearchState {
+    SearchState(const Board &root, SharedSearch &shared, int id)
+            : board(root), shared(shared), table(shared.table), id(id) {
+        // the search plays up to max_search_ply moves on top of the ones already played
+        if (board.ply > max_game_ply - max_search_ply) board.trim_history();
+        if (shared.limits.network) {
+            accumulators.reset(new AccumulatorStack(*shared.limits.network, max_search_ply));
+            accumulators->refresh(board);
+        }
+    }
+
+    Board board;
+    SharedSearch &shared;
+    TranspositionTable &table;
+    int id; // 0 for the main thread, which watches the limits and picks the move
+    U64 nodes = 0;
+    U64 reported_nodes = 0; // nodes already added to shared.nodes
+    bool stopped = false;
+    int root_move = 0; // best move of the last completed iteration, searched first in the next one
+    PawnTable pawn_table;
+    int killers[max_search_ply][num_killers] = {};
+    ButterflyHistory history = {};
+    std::unique_ptr<AccumulatorStack> accumulators; // only when searching with a network
+
+    // triangular pv table, pv[ply] holds the best line found from ply onwards, up to pv_length[ply]
+    // https://www.chessprogramming.org/Triangular_PV-Table
+    int pv[max_search_ply][max_search_ply];
+    int pv_length[max_search_ply];
+};
+
+/// \param shared
+/// \return double seconds since the search started
+static double elapsed_seconds(const SharedSearch &shared) {
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - shared.start;
+    return elapsed.count();
+}
+
+/// add this thread's nodes to the shared count, and stop once the search has used up its time or nodes
+/// only the main thread decides when to stop, the helpers follow it
+/// \param state
+static void check_limits(SearchState &state) {
+    SharedSearch &shared = state.shared;
+    shared.nodes.fetch_add(state.nodes - state.reported_nodes, std::memory_order_relaxed);
+    state.reported_nodes = state.nodes;
+
+    if (state.id == 0) {
+        const SearchLimits &limits = shared.limits;
+        if ((limits.nodes && shared.nodes.load(std::memory_order_relaxed) >= limits.nodes) ||
+            (limits.movetime_ms && elapsed_seconds(shared) * 1000.0 >= limits.movetime_ms) ||
+            (limits.stop && limits.stop->load(std::memory_order_relaxed))) {
+            shared.stop.store(true, std::memory_order_relaxed);
+        }
+    }
+    if (shared.stop.load(std::memory_order_relaxed)) state.stopped = true;
+}
+
+/// \param state
+/// \return int static evaluation of the thread's position, from the network if the search has one
+static inline int evaluate(SearchState &state) {
+    return state.accumulators ? state.accumulators->evaluate(state.board.side_to_move)
+                              : evaluate(state.board, state.pawn_table);
+}
+
+/// mate scores count plies from the root, but the table needs them counted from the position they are stored for,
+/// since it can be reached again at a different ply
+/// \param score
+/// \param ply distance from the root
+/// \return int score to store
+static inline int score_to_table(int score, int ply) {
+    return score > mate_bound ? score + ply : score < -mate_bound ? score - ply : score;
+}
+
+/// \param score score from the table
+/// \param ply distance from the root
+/// \return int score counted from the root
+static inline int score_from_table(int score, int ply) {
+    return score > mate_bound ? score - ply : score < -mate_bound ? score + ply : score;
+}
+
+/// nudge a history score towards the most it can be, or the least for a negative bonus, by less the closer it is
+/// https://www.chessprogramming.org/History_Heuristic
+/// \param entry
+/// \param bonus
+static inline void update_history(int &entry, int bonus) {
+    entry += bonus - entry * std::abs(bonus) / max_history;
+}
+
+/// a quiet move caused a beta cutoff, make it a killer at this ply and raise its history,
+/// lowering the history of the quiet moves searched before it that didn't
+/// \param state
+/// \param move
+/// \param ply
+/// \param depth
+/// \param quiets quiet moves searched before move
+/// \param num_quiets
+static void update_quiet_stats(SearchState &state, int move, int ply, int depth, const int *quiets, int num_quiets) {
+    int *killers = state.killers[ply];
+    if (killers[0] != move) {
+        killers[1] = killers[0];
+        killers[0] = move;
+    }
+
+    // deeper cutoffs save more work
+    int bonus = std::min(depth * depth, 400);
+    int side = state.board.side_to_move;
+    update_history(state.history[side][get_move_source(move)][get_move_target(move)], bonus);
+    for (int i = 0; i < num_quiets; i++) {
+        update_history(state.history[side][get_move_source(quiets[i])][get_move_target(quiets[i])], -bonus);
+    }
+}
+
+/// quiescence search, extends a leaf with captures and queen promotions until the position is quiet,
+/// so the search doesn't stop in the middle of an exchange and misjudge it
+/// the side to move can stand pat on the static evaluation instead of capturing, except when in check,
+/// where every evasion is searched
+/// https://www.chessprogramming.org/Quiescence_Search
+/// \param state
+/// \param alpha lower bound of scores we are interested in
+/// \param beta upper bound
+/// \param ply distance from the root
+/// \return int score, or 0 if the search was stopped
+static int quiescence(SearchState &state, int alpha, int beta, int ply) {
+    Board &board = state.board;
+    state.nodes++;
+    if ((state.nodes & 2047) == 0) check_limits(state);
+    if (state.stopped) return 0;
+
+    bool in_check = board.in_check();
+    if (ply >= max_search_ply - 1) return evaluate(state);
+
+    int best_score = -infinity_score;
+    int stand_pat = 0;
+    if (!in_check) {
+        stand_pat = evaluate(state);
+        if (stand_pat >= beta) return stand_pat;
+        if (stand_pat > alpha) alpha = stand_pat;
+        best_score = stand_pat;
+    }
+
+    MovePicker picker(board, 0, nullptr, nullptr, !in_check);
+    int move;
+    while ((move = picker.next_move())) {
+        // delta pruning, even winning the captured piece and a margin for positional gains can't reach alpha
+        // https://www.chessprogramming.org/Delta_Pruning
+        if (!in_check) {
+            int gain = get_move_capture(move) ? see_values[get_move_captured_piece(move) >> 1] : 0;
+            if (get_move_promoted(move)) gain += see_values[queen / 2] - see_values[pawn / 2];
+            if (stand_pat + gain + delta_margin <= alpha) continue;
+        }
+
+        board.makeMove(move);
+        if (state.accumulators) state.accumulators->push(move);
+        int score = -quiescence(state, -beta, -alpha, ply + 1);
+        if (state.accumulators) state.accumulators->pop();
+        board.undoMove(move);
+        if (state.stopped) return 0;
+
+        if (score > best_score) {
+            best_score = score;
+            if (score > alpha) {
+                alpha = score;
+                if (alpha >= beta) break;
+            }
+        }
+    }
+
+    // every evasion was searched, so no moves is checkmate
+    if (best_score == -infinity_score) best_score = -mate_score + ply;
+    return best_score;
+}
+
+/// negamax alpha-beta search, the score is always from the point of view of the side to move
+/// https://www.chessprogramming.org/Alpha-Beta#Negamax_Framework
+/// \param state
+/// \param depth plies left to search
+/// \param alpha lower bound of scores we are interested in
+/// \param beta upper bound, the opponent already has a way to hold us to this
+/// \param ply distance from the root
+/// \return int score, or 0 if the search was stopped (the caller throws it away)
+static int negamax(SearchState &state, int depth, int alpha, int beta, int ply) {
+    Board &board = state.board;
+    state.pv_length[ply] = ply;
+    if (ply > 0 && board.is_draw()) return 0;
+
+    // look a ply further while in check, so a mate or lost piece isn't hidden just past the horizon
+    bool in_check = board.in_check();
+    if (in_check) depth++;
+    // the horizon, where the quiescence search takes over (and counts the node)
+    if (depth <= 0 || ply >= max_search_ply - 1) return quiescence(state, alpha, beta, ply);
+
+    state.nodes++;
+    if ((state.nodes & 2047) == 0) check_limits(state);
+    if (state.stopped) return 0;
+
+
+    // a deep enough result for this position, from another move order or an earlier iteration, settles it
+    // the root always searches, so it has a full line to report
+    TTData entry;
+    int hash_move = 0;
+    if (state.table.probe(board.hash_key, entry)) {
+        hash_move = entry.move;
+        int score = score_from_table(entry.score, ply);
+        if (ply > 0 && entry.depth >= depth &&
+            (entry.bound == bound_exact || (entry.bound == bound_lower && score >= beta) ||
+             (entry.bound == bound_upper && score <= alpha))) {
+            if (hash_move && entry.bound != bound_upper) {
+                state.pv[ply][ply] = hash_move;
+                state.pv_length[ply] = ply + 1;
+            }
+            return score;
+        }
+    }
+    if (ply == 0 && state.root_move) hash_move = state.root_move;
+
+    MovePicker picker(board, hash_move, state.killers[ply], &state.history);
+    int original_alpha = alpha;
+    int best_score = -infinity_score;
+    int best_move = 0;
+    int quiets[max_moves];
+    int num_quiets = 0;
+    int move;
+    while ((move = picker.next_move())) {
+        bool quiet = !get_move_capture(move) && !get_move_promoted(move);
+        // start loading the child's table entry while the move is made
+        state.table.prefetch(board.key_after(move));
+        board.makeMove(move);
+        if (state.accumulators) state.accumulators->push(move);
+        int score = -negamax(state, depth - 1, -beta, -alpha, ply + 1);
+        if (state.accumulators) state.accumulators->pop();
+        board.undoMove(move);
+        if (state.stopped) return 0;
+
+        if (score > best_score) {
+            best_score = score;
+            if (score > alpha) {
+                alpha = score;
+                best_move = move;
+                // this move followed by the child's best line is the new best line from here
+                state.pv[ply][ply] = move;
+                for (int i = ply + 1; i < state.pv_length[ply + 1]; i++) {
+                    state.pv[ply][i] = state.pv[ply + 1][i];
+                }
+                state.pv_length[ply] = state.pv_length[ply + 1];
+                if (alpha >= beta) {
+                    if (quiet) update_quiet_stats(state, move, ply, depth, quiets, num_quiets);
+                    break;
+                }
+            }
+        }
+        if (quiet) quiets[num_quiets++] = move;
+    }
+
+    // no legal moves, checkmate or stalemate
+    if (best_score == -infinity_score) best_score = in_check ? -mate_score + ply : 0;
+
+    int bound = best_score >= beta ? bound_lower : best_score > original_alpha ? bound_exact : bound_upper;
+    state.table.store(board.hash_key, best_move, score_to_table(best_score, ply), depth, bound);
+    return best_score;
+}
+
+/// print a completed iteration in the style of a uci info line
+/// \param result
+/// \param table
+static void print_iteration(const SearchResult &result, const TranspositionTable &table) {
+    double nps = result.seconds > 0 ? (double) result.nodes / result.seconds : 0.0;
+    if (result.score > mate_bound) {
+        printf("info depth %d score mate %d", result.depth, (mate_score - result.score + 1) / 2);
+    } else if (result.score < -mate_bound) {
+        printf("info depth %d score mate -%d", result.depth, (mate_score + result.score) / 2);
+    } else {
+        printf("info depth %d score cp %d", result.depth, result.score);
+    }
+    printf(" nodes %llu nps %.0f hashfull %d time %.0f pv", result.nodes, nps, table.hashfull(),
+           result.seconds * 1000.0);
+    for (int move: result.pv) {
+        printf(" %s", move_to_string(move).c_str());
+    }
+    printf("\n");
+}
+
+/// iterative deepening, one full alpha-beta search per depth until the search is stopped or runs out of depth
+/// the best move of each iteration is searched first in the next, so the deeper searches cut off sooner
+/// https://www.chessprogramming.org/Iterative_Deepening
+/// \param state thread to search with
+/// \param result filled in after each completed iteration, only by the main thread
+static void iterative_deepening(SearchState &state, SearchResult *result) {
+    const SearchLimits &limits = state.shared.limits;
+    int max_depth = limits.depth > 0 && limits.depth < max_search_ply ? limits.depth : max_search_ply - 1;
+    for (int depth = 1; depth <= max_depth; depth++) {
+        // every other helper searches a ply deeper than the main thread, so the threads spread over two depths
+        // and fill the table with results each other can use rather than all repeating the same work
+        int search_depth = std::min(depth + (state.id & 1), max_depth);
+        int score = negamax(state, search_depth, -infinity_score, infinity_score, 0);
+        // a partly searched iteration can miss the best move, keep the last complete one
+        if (state.stopped) break;
+        state.root_move = state.pv[0][0];
+        if (state.id != 0) continue;
+
+        result->score = score;
+        result->depth = depth;
+        result->pv.clear();
+        for (int i = 0; i < state.pv_length[0]; i++) {
+            result->pv.push_back(state.pv[0][i]);
+        }
+        result->best_move = result->pv[0];
+        result->nodes = state.shared.nodes.load(std::memory_order_relaxed) + state.nodes - state.reported_nodes;
+        result->seconds = elapsed_seconds(state.shared);
+        if (limits.print_info) print_iteration(*result, state.table);
+
+        // every mate within depth plies has been seen, so searching deeper can't find a shorter one
+        if (score > mate_bound && mate_score - score <= depth) break;
+        if (score < -mate_bound && mate_score + score <= depth) break;
+    }
+}
+
+/// search a position with lazy smp, limits.threads threads searching the same root on their own copies of the
+/// board, sharing only the transposition table and the signal to stop
+/// the main thread watches the limits and its last completed iteration gives the move, the helpers only
+/// speed it up through the entries they leave in the table
+/// https://www.chessprogramming.org/Lazy_SMP
+/// \param board position to search
+/// \param limits
+/// \param table transposition table, kept between searches of the same game
+/// \return SearchResult of the main thread's deepest completed iteration
+SearchResult search(Board &board, const SearchLimits &limits, TranspositionTable &table) {
+    SearchResult result;
+    MoveList root_moves = board.get_legal_moves();
+    if (root_moves.empty()) {
+        result.score = board.in_check() ? -mate_score : 0;
+        return result;
+    }
+
+    table.new_search();
+    SharedSearch shared(limits, table);
+    int num_threads = std::max(limits.threads, 1);
+    std::vector<std::unique_ptr<SearchState>> states;
+    for (int i = 0; i < num_threads; i++) {
+        states.emplace_back(new SearchState(board, shared, i));
+    }
+
+    std::vector<std::thread> helpers;
+    for (int i = 1; i < num_threads; i++) {
+        helpers.emplace_back(iterative_deepening, std::ref(*states[i]), nullptr);
+    }
+    iterative_deepening(*states[0], &result);
+    // the main thread has finished, because of a limit or because it reached its depth, and the helpers with it
+    shared.stop.store(true, std::memory_order_relaxed);
+    for (std::thread &helper: helpers) {
+        helper.join();
+    }
+
+    // stopped before the first iteration finished, any legal move is better than none
+    if (!result.best_move) {
+        result.best_move = root_moves[0];
+        result.pv.push_back(result.best_move);
+    }
+    result.nodes = 0;
+    for (const std::unique_ptr<SearchState> &state: states) {
+        result.nodes += state->nodes;
+    }
+    result.seconds = elapsed_seconds(shared);
+    return result;
+}
+
+/// search a position with a transposition table of its own, limits.hash_mb in size
+/// \param board
+/// \param limits
+/// \return SearchResult of the deepest completed iteration
+SearchResult search(Board &board, const SearchLimits &limits) {
+    TranspositionTable table(limits.hash_mb);
+    return search(board, limits, table);
+}
+
+/// search a position and print each iteration and the best move found
+/// \param fen
+/// \param board
+/// \param limits
+void run_search(std::string fen, Board &board, const SearchLimits &limits) {
+    board.load_FEN(fen);
+    SearchResult result = search(board, limits);
+    double nps = result.seconds > 0 ? (double) result.nodes / result.seconds : 0.0;
+    printf("bestmove %s, depth = %d, nodes = %llu, time = %.3fs, nps = %.0f\n",
+           result.best_move ? move_to_string(result.best_move).c_str() : "none", result.depth, result.nodes,
+           result.seconds, nps);
+}
+
+/// search a position to a fixed depth with 1, 2, 4 ... max_threads threads and print how the node count and the
+/// time to reach the depth change with the number of threads, each run starting from an empty table
+/// \param depth
+/// \param fen
+/// \param board
+/// \param max_threads
+void run_search_scaling(int depth, std::string fen, Board &board, int max_threads) {
+    board.load_FEN(fen);
+    SearchLimits limits;
+    limits.depth = depth;
+    limits.print_info = false;
+    TranspositionTable table(limits.hash_mb);
+    int clear_threads = std::max((int) std::thread::hardware_concurrency(), 1);
+
+    double base_seconds = 0.0;
+    U64 base_nodes = 0;
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        table.clear(clear_threads);
+        limits.threads = threads;
+        SearchResult result = search(board, limits, table);
+        if (threads == 1) {
+            base_seconds = result.seconds;
+            base_nodes = result.nodes;
+        }
+        double nps = result.seconds > 0 ? (double) result.nodes / result.seconds : 0.0;
+        double speedup = result.seconds > 0 ? base_seconds / result.seconds : 0.0;
+        double node_ratio = base_nodes ? (double) result.nodes / (double) base_nodes : 0.0;
+        printf("threads = %d, depth = %d, nodes = %llu, time = %.3fs, nps = %.0f, time to depth speedup = %.2fx, "
+               "nodes vs 1 thread = %.2fx, bestmove %s\n", threads, result.depth, result.nodes, result.seconds, nps,
+               speedup, node_ratio, result.best_move ? move_to_string(result.best_move).c_str() : "none");
+    }
+}
@@ -0,0 +1,52 @@
+//
+// Created by Hayden Collins on 1/12/24.
+//
+
+#ifndef BITBOARDS_SEARCH_H
+#define BITBOARDS_SEARCH_H
+
+#include "Board.h"
+#include "TranspositionTable.h"
+#include "NNUE.h"
+#include <atomic>
+#include <string>
+
+// deepest ply a search can reach, iterative deepening depth plus check extensions and the quiescence search
+const int max_search_ply = 128;
+
+// scores are in centipawns, a mate in n plies scores mate_score - n so shorter mates are preferred
+const int infinity_score = 32001;
+const int mate_score = 32000;
+const int mate_bound = mate_score - max_search_ply; // any score above this is a forced mate
+
+// when to stop searching, a zero means no limit
+struct SearchLimits {
+    int depth = max_search_ply - 1;
+    int movetime_ms = 0;
+    U64 nodes = 0;
+    bool print_info = true; // print a line for each completed iteration
+    size_t hash_mb = 16; // size of the transposition table search(board, limits) makes for itself
+    int threads = 1; // threads searching together, sharing the transposition table
+    std::atomic<bool> *stop = nullptr; // set from another thread to end the search early
+    const Network *network = nullptr; // evaluate with this network instead of the hand written evaluation
+};
+
+// the best line found by the deepest completed iteration
+struct SearchResult {
+    int best_move = 0; // 0 if the position has no legal moves
+    int score = 0;
+    int depth = 0;
+    U64 nodes = 0;
+    double seconds = 0.0;
+    MoveList pv;
+};
+
+SearchResult search(Board &board, const SearchLimits &limits, TranspositionTable &table);
+
+SearchResult search(Board &board, const SearchLimits &limits);
+
+void run_search(std::string fen, Board &board, const SearchLimits &limits);
+
+void run_search_scaling(int depth, std::string fen, Board &board, int max_threads);
+
+#endif //BITBOARDS_SEARCH_H
@@ -0,0 +1,175 @@
+//
+// Created by Hayden Collins on 1/14/24.
+//
+
+#include "TranspositionTable.h"
+#include <algorithm>
+#include <climits>
+#include <new>
+#include <thread>
+#include <vector>
+
+// entry data layout
+// bits 0-31 move, 32-47 score, 48-55 depth, 56-57 bound, 58-63 age
+const int tt_age_bits = 6;
+const int tt_age_mask = (1 << tt_age_bits) - 1;
+
+static inline U64 pack_entry(int move, int score, int depth, int bound, int age) {
+    return (U64) (uint32_t) move | (U64) (uint16_t) (int16_t) score << 32 | (U64) (uint8_t) depth << 48 |
+           (U64) bound << 56 | (U64) age << 58;
+}
+
+static inline int entry_move(U64 data) { return (int) (uint32_t) data; }
+
+static inline int entry_score(U64 data) { return (int16_t) (uint16_t) (data >> 32); }
+
+static inline int entry_depth(U64 data) { return (int) ((data >> 48) & 0xff); }
+
+static inline int entry_bound(U64 data) { return (int) ((data >> 56) & 0x3); }
+
+static inline int entry_age(U64 data) { return (int) (data >> 58); }
+
+/// run a function over the buckets, split into one slice per thread
+/// \param num_buckets
+/// \param num_threads
+/// \param function called with the first and one past the last bucket of each slice
+template<typename Function>
+static void for_each_slice(size_t num_buckets, int num_threads, Function function) {
+    size_t slice = (num_buckets + num_threads - 1) / num_threads;
+    auto run_slice = [num_buckets, slice, &function](size_t begin) {
+        size_t end = std::min(begin + slice, num_buckets);
+        if (begin < end) function(begin, end);
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 1; i < num_threads; i++) {
+        threads.emplace_back(run_slice, i * slice);
+    }
+    run_slice(0);
+    for (std::thread &thread: threads) {
+        thread.join();
+    }
+}
+
+/// allocate the table with the largest power of two number of buckets that fits in size_mb
+/// \param size_mb table size in megabytes
+TranspositionTable::TranspositionTable(size_t size_mb) {
+    resize(size_mb);
+}
+
+/// reallocate and clear the table, must not be called while a search is using it
+/// \param size_mb table size in megabytes
+void TranspositionTable::resize(size_t size_mb) {
+    size_t max_buckets = std::max((size_mb * 1024 * 1024) / sizeof(TTBucket), (size_t) 1);
+    num_buckets = 1;
+    while (num_buckets * 2 <= max_buckets) {
+        num_buckets *= 2;
+    }
+    index_mask = num_buckets - 1;
+
+    // new[] only promises the alignment of a char, so over-allocate by a line and align by hand
+    memory.reset(new char[num_buckets * sizeof(TTBucket) + cache_line_size]);
+    size_t offset = (cache_line_size - (reinterpret_cast<uintptr_t>(memory.get()) % cache_line_size)) %
+                    cache_line_size;
+    buckets = reinterpret_cast<TTBucket *>(memory.get() + offset);
+
+    // the atomics have to be constructed before they are used, value initialisation also zeroes them
+    TTBucket *buckets = this->buckets;
+    for_each_slice(num_buckets, std::max((int) std::thread::hardware_concurrency(), 1),
+                   [buckets](size_t begin, size_t end) {
+                       for (size_t i = begin; i < end; i++) {
+                           new(buckets + i) TTBucket{};
+                       }
+                   });
+    age = 0;
+}
+
+/// empty the table, each thread zeroing its own slice of it
+/// \param num_threads
+void TranspositionTable::clear(int num_threads) {
+    TTBucket *buckets = this->buckets;
+    for_each_slice(num_buckets, num_threads, [buckets](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            for (TTEntry &entry: buckets[i].entries) {
+                entry.key_xor.store(0, std::memory_order_relaxed);
+                entry.data.store(0, std::memory_order_relaxed);
+            }
+        }
+    });
+    age = 0;
+}
+
+/// start a new search, entries written by earlier searches become the first to be replaced
+void TranspositionTable::new_search() {
+    age = (age + 1) & tt_age_mask;
+}
+
+/// look up a position
+/// \param key zobrist key of the position
+/// \param found set to the stored move, score, depth and bound on a hit
+/// \return bool true if the table held this position
+bool TranspositionTable::probe(U64 key, TTData &found) const {
+    const TTBucket &bucket = buckets[key & index_mask];
+    for (const TTEntry &entry: bucket.entries) {
+        U64 data = entry.data.load(std::memory_order_relaxed);
+        U64 key_xor = entry.key_xor.load(std::memory_order_relaxed);
+        if ((key_xor ^ data) == key && entry_bound(data) != bound_none) {
+            found.move = entry_move(data);
+            found.score = entry_score(data);
+            found.depth = entry_depth(data);
+            found.bound = entry_bound(data);
+            return true;
+        }
+    }
+    return false;
+}
+
+/// store a search result, over the same position if the bucket has it, otherwise over the entry that is
+/// least worth keeping, the shallowest once older searches count against an entry's depth
+/// \param key zobrist key of the position
+/// \param move best move found, 0 keeps the move already stored for this position
+/// \param score
+/// \param depth
+/// \param bound TTBound of the score
+void TranspositionTable::store(U64 key, int move, int score, int depth, int bound) {
+    TTBucket &bucket = buckets[key & index_mask];
+    TTEntry *replace = nullptr;
+    int replace_value = INT_MAX;
+    for (TTEntry &entry: bucket.entries) {
+        U64 data = entry.data.load(std::memory_order_relaxed);
+        U64 key_xor = entry.key_xor.load(std::memory_order_relaxed);
+        if ((key_xor ^ data) == key) {
+            // a deeper result for this position from the current search is worth more than a shallow bound
+            if (bound != bound_exact && entry_age(data) == age && depth + 2 < entry_depth(data)) return;
+            if (!move) move = entry_move(data);
+            replace = &entry;
+            break;
+        }
+
+        int value = entry_bound(data) == bound_none
+                    ? INT_MIN
+                    : entry_depth(data) - 8 * ((age - entry_age(data)) & tt_age_mask);
+        if (value < replace_value) {
+            replace_value = value;
+            replace = &entry;
+        }
+    }
+
+    U64 data = pack_entry(move, score, depth, bound, age);
+    replace->key_xor.store(key ^ data, std::memory_order_relaxed);
+    replace->data.store(data, std::memory_order_relaxed);
+}
+
+/// estimate how full the table is from the entries of the current search in its first buckets
+/// \return int permille of entries in use
+int TranspositionTable::hashfull() const {
+    size_t sample = std::min(num_buckets, (size_t) 1000 / tt_bucket_size);
+    int used = 0;
+    for (size_t i = 0; i < sample; i++) {
+        for (const TTEntry &entry: buckets[i].entries) {
+            U64 data = entry.data.load(std::memory_order_relaxed);
+            if (entry_bound(data) != bound_none && entry_age(data) == age) used++;
+        }
+    }
+    return (int) (used * 1000 / (sample * tt_bucket_size));
+}
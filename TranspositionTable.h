@@ -0,0 +1,96 @@
+//
+// Created by Hayden Collins on 1/14/24.
+//
+
+#ifndef BITBOARDS_TRANSPOSITIONTABLE_H
+#define BITBOARDS_TRANSPOSITIONTABLE_H
+
+#include "utils.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+#if !defined(__GNUC__) && defined(_MSC_VER)
+#include <xmmintrin.h>
+#endif
+
+// how a stored score relates to the position's true score
+// upper: every move failed low, the score is at most this. lower: a move failed high, it is at least this
+enum TTBound {
+    bound_none, bound_upper, bound_lower, bound_exact
+};
+
+// what a probe found out about a position
+struct TTData {
+    int move; // best move found, 0 if none
+    int score;
+    int depth;
+    int bound;
+};
+
+// one position, data packs the move, score, depth, bound and age of the table when it was written
+// the key is stored xored with data, so an entry half written by one thread while another reads it
+// fails the key check instead of being trusted
+// https://www.chessprogramming.org/Shared_Hash_Table#Lockless
+struct TTEntry {
+    std::atomic<U64> key_xor;
+    std::atomic<U64> data;
+};
+
+// entries sharing a cache line, a probe only ever touches one line
+const int tt_bucket_size = 4;
+const int cache_line_size = 64;
+
+struct alignas(cache_line_size) TTBucket {
+    TTEntry entries[tt_bucket_size];
+};
+
+static_assert(sizeof(TTBucket) == cache_line_size, "a bucket must fill exactly one cache line");
+static_assert(std::is_trivially_destructible<TTBucket>::value, "buckets are never destroyed, only freed");
+
+// transposition table shared by every search thread without locks
+// https://www.chessprogramming.org/Transposition_Table
+class TranspositionTable {
+public:
+    explicit TranspositionTable(size_t size_mb);
+
+    void resize(size_t size_mb);
+
+    void clear(int num_threads = 1);
+
+    void new_search();
+
+    bool probe(U64 key, TTData &found) const;
+
+    void store(U64 key, int move, int score, int depth, int bound);
+
+    /// start loading a position's bucket into the cache, so a probe or store of it soon after doesn't wait on memory
+    /// \param key zobrist key of the position
+    void prefetch(U64 key) const {
+        const TTBucket *bucket = &buckets[key & index_mask];
+#if defined(__GNUC__)
+        __builtin_prefetch(bucket);
+#elif defined(_MSC_VER)
+        _mm_prefetch(reinterpret_cast<const char *>(bucket), _MM_HINT_T0);
+#else
+        (void) bucket; // no portable prefetch, the probe just has to wait for it
+#endif
+    }
+
+    int hashfull() const;
+
+    size_t size() const { return num_buckets * tt_bucket_size; }
+
+private:
+    // buckets are constructed in this, aligned to a cache line
+    // they are trivially destructible, so freeing the memory is all it takes to get rid of them
+    std::unique_ptr<char[]> memory;
+    TTBucket *buckets = nullptr;
+    size_t num_buckets = 0;
+    U64 index_mask = 0;
+    uint8_t age = 0; // bumped every search so entries left over from old searches are replaced first
+};
+
+#endif //BITBOARDS_TRANSPOSITIONTABLE_H
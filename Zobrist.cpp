@@ -0,0 +1,40 @@
+//
+// Created by Hayden Collins on 1/3/24.
+//
+
+#include "Zobrist.h"
+
+U64 piece_keys[12][64];
+U64 enpassant_keys[64];
+U64 castling_keys[16];
+U64 side_key;
+
+static U64 random_state;
+
+/// xorshift64* pseudo random number generator
+/// \return U64 random number
+static U64 get_random_U64() {
+    random_state ^= random_state >> 12;
+    random_state ^= random_state << 25;
+    random_state ^= random_state >> 27;
+    return random_state * 0x2545f4914f6cdd1dULL;
+}
+
+/// fill the zobrist key tables with random numbers
+void init_zobrist_keys() {
+    // fixed seed so keys (and therefore hashes) are the same on every run
+    random_state = 0x9e3779b97f4a7c15ULL;
+
+    for (int piece = 0; piece < 12; piece++) {
+        for (int square = 0; square < 64; square++) {
+            piece_keys[piece][square] = get_random_U64();
+        }
+    }
+    for (int square = 0; square < 64; square++) {
+        enpassant_keys[square] = get_random_U64();
+    }
+    for (int rights = 0; rights < 16; rights++) {
+        castling_keys[rights] = get_random_U64();
+    }
+    side_key = get_random_U64();
+}
@@ -0,0 +1,22 @@
+//
+// Created by Hayden Collins on 1/3/24.
+//
+
+#ifndef BITBOARDS_ZOBRIST_H
+#define BITBOARDS_ZOBRIST_H
+
+#include "utils.h"
+
+// zobrist hashing keys
+// https://www.chessprogramming.org/Zobrist_Hashing
+extern U64 piece_keys[12][64]; // [piece][square]
+extern U64 enpassant_keys[64]; // [square]
+extern U64 castling_keys[16]; // [castling_rights]
+extern U64 side_key; // xor'd in when black is to move
+
+// starting value of every pawn key, so a position without pawns isn't keyed 0 like the empty entries of a pawn table
+const U64 pawn_key_seed = 0x9e3779b97f4a7c15ULL;
+
+void init_zobrist_keys();
+
+#endif //BITBOARDS_ZOBRIST_H
@@ -0,0 +1,113 @@
+//
+// Created by Hayden Collins on 1/8/24.
+//
+
+#include "Board.h"
+#include "Perft.h"
+#include <chrono>
+#include <cstring>
+
+// standard perft positions with known node counts
+// https://www.chessprogramming.org/Perft_Results
+struct BenchPosition {
+    const char *name;
+    const char *fen;
+    int depth;
+    U64 expected_nodes;
+};
+
+static const BenchPosition bench_positions[] = {
+        {"startpos",  "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",                 5, 4865609ULL},
+        {"kiwipete",  "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",     4, 4085603ULL},
+        {"position3", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",                                6, 11030083ULL},
+        {"position4", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",         5, 15833292ULL},
+        {"position5", "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",                4, 2103487ULL},
+        {"position6", "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", 4, 3894594ULL},
+};
+
+const int num_bench_positions = sizeof(bench_positions) / sizeof(bench_positions[0]);
+
+// result of running one bench position
+struct BenchResult {
+    U64 nodes;
+    double seconds;
+    double nps;
+    bool passed;
+};
+
+/// run perft on every bench position and print one record per position
+/// usage: bitboards_bench [csv|json] [bulk] [pseudo]
+/// bulk counts the legal moves at the last ply instead of playing them,
+/// pseudo generates pseudo-legal moves and tests each one with is_legal instead of generating legal moves
+/// \return 0 if every node count matched, 1 otherwise
+int main(int argc, char *argv[]) {
+    bool json = false, bulk = false, pseudo = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "json") == 0) {
+            json = true;
+        } else if (strcmp(argv[i], "bulk") == 0) {
+            bulk = true;
+        } else if (strcmp(argv[i], "pseudo") == 0) {
+            pseudo = true;
+        } else if (strcmp(argv[i], "csv") != 0) {
+            printf("usage: bitboards_bench [csv|json] [bulk] [pseudo]\n");
+            return 1;
+        }
+    }
+    const char *mode = bulk ? "bulk" : "full";
+    const char *generator = pseudo ? "pseudo" : "legal";
+
+    init_zobrist_keys();
+    Board board;
+
+    BenchResult results[num_bench_positions];
+    U64 total_nodes = 0;
+    double total_seconds = 0.0;
+    bool all_passed = true;
+
+    for (int i = 0; i < num_bench_positions; i++) {
+        const BenchPosition &position = bench_positions[i];
+        board.load_FEN(position.fen);
+
+        auto start = std::chrono::steady_clock::now();
+        U64 nodes = pseudo ? perft_pseudo_legal(position.depth, board, bulk) : perft_nodes(position.depth, board, bulk);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        BenchResult &result = results[i];
+        result.nodes = nodes;
+        result.seconds = elapsed.count();
+        result.nps = result.seconds > 0 ? (double) nodes / result.seconds : 0.0;
+        result.passed = nodes == position.expected_nodes;
+
+        total_nodes += nodes;
+        total_seconds += result.seconds;
+        all_passed &= result.passed;
+    }
+    double total_nps = total_seconds > 0 ? (double) total_nodes / total_seconds : 0.0;
+
+    if (json) {
+        printf("{\n  \"mode\": \"%s\",\n  \"generator\": \"%s\",\n  \"positions\": [\n", mode, generator);
+        for (int i = 0; i < num_bench_positions; i++) {
+            const BenchPosition &position = bench_positions[i];
+            const BenchResult &result = results[i];
+            printf("    {\"name\": \"%s\", \"fen\": \"%s\", \"depth\": %d, \"nodes\": %llu, \"expected\": %llu, "
+                   "\"passed\": %s, \"seconds\": %.6f, \"nps\": %.0f}%s\n",
+                   position.name, position.fen, position.depth, result.nodes, position.expected_nodes,
+                   result.passed ? "true" : "false", result.seconds, result.nps,
+                   i + 1 < num_bench_positions ? "," : "");
+        }
+        printf("  ],\n  \"total\": {\"nodes\": %llu, \"seconds\": %.6f, \"nps\": %.0f, \"passed\": %s}\n}\n",
+               total_nodes, total_seconds, total_nps, all_passed ? "true" : "false");
+    } else {
+        printf("name,mode,generator,depth,nodes,expected,passed,seconds,nps\n");
+        for (int i = 0; i < num_bench_positions; i++) {
+            const BenchPosition &position = bench_positions[i];
+            const BenchResult &result = results[i];
+            printf("%s,%s,%s,%d,%llu,%llu,%d,%.6f,%.0f\n", position.name, mode, generator, position.depth, result.nodes,
+                   position.expected_nodes, result.passed, result.seconds, result.nps);
+        }
+        printf("total,%s,%s,,%llu,,%d,%.6f,%.0f\n", mode, generator, total_nodes, all_passed, total_seconds, total_nps);
+    }
+
+    return all_passed ? 0 : 1;
+}
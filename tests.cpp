@@ -0,0 +1,98 @@
+//
+// Created by Hayden Collins on 1/20/24.
+//
+
+#include "Board.h"
+#include <cstdio>
+#include <string>
+
+// legal move counts of positions with pins, checks and en passant edge cases
+// reference https://gist.github.com/peterellisjones/8c46c28141c162d1d8a0f0badbc9cff9
+struct MoveCountTest {
+    const char *name;
+    const char *fen;
+    int expected_moves;
+};
+
+static const MoveCountTest move_count_tests[] = {
+        {"in check",                         "r6r/1b2k1bq/8/8/7B/8/8/R3K2R b KQ - 3 2",                            8},
+        {"en passant out of check",          "8/8/8/2k5/2pP4/8/B7/4K3 b - d3 0 3",                                 8},
+        {"after 1.a3 Na6",                   "r1bqkbnr/pppppppp/n7/8/8/P7/1PPPPPPP/RNBQKBNR w KQkq - 2 2",         19},
+        {"in check 2",                       "r3k2r/p1pp1pb1/bn2Qnp1/2qPN3/1p2P3/2N5/PPPBBPPP/R3K2R b KQkq - 3 2", 5},
+        {"rook pin with rook",               "k7/8/8/8/q2R2K1/8/8/8 w - - 0 1",                                    13},
+        {"bishop pin with bishop",           "k7/8/5K2/8/3B4/8/1q6/8 w - - 0 1",                                   11},
+        {"bishop pin with rook",             "k7/8/5K2/8/3R4/8/1q6/8 w - - 0 1",                                   8},
+        {"general position",                 "2kr3r/p1ppqpb1/bn2Qnp1/3PN3/1p2P3/2N5/PPPBBPPP/R3K2R b KQ - 3 2",    44},
+        {"promotion + other stuff",          "rnb2k1r/pp1Pbppp/2p5/q7/2B5/8/PPPQNnPP/RNB1K2R w KQ - 3 9",          39},
+        {"pinned pawn",                      "2r5/3pk3/8/2P5/8/2K5/8/8 w - - 5 4",                                 9},
+        {"pinned pawn + illegal en passant", "2r5/4k3/8/2Pp4/8/2K5/8/8 w - d6 5 4",                                8},
+        {"x ray illegal en passant",         "7k/8/8/q2Pp2K/8/8/8/8 w - e6 0 1",                                   6},
+};
+
+// static exchange evaluation of one move
+// https://www.chessprogramming.org/SEE_-_The_Swap_Algorithm
+struct SeeTest {
+    const char *name;
+    const char *fen;
+    const char *move;
+    int expected_see;
+};
+
+static const SeeTest see_tests[] = {
+        {"rook takes an undefended pawn",
+                "1k1r4/1pp4p/p7/4p3/8/P5P1/1PP4P/2K1R3 w - - 0 1",           "e1e5", 100},
+        {"knight takes a pawn defended by a knight, with more of both sides' pieces behind",
+                "1k1r3q/1ppn3p/p4b2/4p3/8/P2N2P1/1PP1R1BP/2K1Q3 w - - 0 1", "d3e5", -200},
+        {"x ray, the back rook recaptures through the square the front rook left",
+                "3rk3/8/8/3p4/8/8/3R4/3R2K1 w - - 0 1",                      "d2d5", 100},
+        {"quiet move, the knight can be taken by a pawn on its new square",
+                "4k3/8/4p3/8/8/2N5/8/4K3 w - - 0 1",                         "c3d5", -300},
+};
+
+/// find a legal move by its source and target squares
+/// \param board
+/// \param move_string e.g. "e1e5"
+/// \return int move, or 0 if there is no such legal move
+static int find_move(Board &board, const std::string &move_string) {
+    for (int move: board.get_legal_moves()) {
+        if (move_to_string(move).compare(0, 4, move_string) == 0) return move;
+    }
+    return 0;
+}
+
+/// run every test and print the ones that fail
+/// built without NDEBUG, so the asserts in the headers it includes are checked too
+/// \return 0 if every test passed, 1 otherwise
+int main() {
+    init_zobrist_keys();
+    Board board;
+    int failures = 0;
+
+    for (const MoveCountTest &test: move_count_tests) {
+        board.load_FEN(test.fen);
+        int moves = board.get_legal_moves().size();
+        if (moves != test.expected_moves) {
+            printf("FAILED %s: %d legal moves, expected %d\n", test.name, moves, test.expected_moves);
+            failures++;
+        }
+    }
+
+    for (const SeeTest &test: see_tests) {
+        board.load_FEN(test.fen);
+        int move = find_move(board, test.move);
+        if (!move) {
+            printf("FAILED %s: %s is not a legal move\n", test.name, test.move);
+            failures++;
+            continue;
+        }
+        int see = board.see(move);
+        if (see != test.expected_see) {
+            printf("FAILED %s: see %d, expected %d\n", test.name, see, test.expected_see);
+            failures++;
+        }
+    }
+
+    int num_tests = sizeof(move_count_tests) / sizeof(move_count_tests[0]) + sizeof(see_tests) / sizeof(see_tests[0]);
+    printf("%d of %d tests passed\n", num_tests - failures, num_tests);
+    return failures ? 1 : 0;
+}
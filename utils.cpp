@@ -38,5 +38,14 @@ void print_bitboard(U64 bitboard) {
     printf("\n     a b c d e f g h\n");
 }
 
-
-
+/// get a move in long algebraic notation, e.g. e2e4 or e7e8q
+/// \param move
+/// \return std::string
+std::string move_to_string(int move) {
+    std::string str = std::string(square_to_cord[get_move_source(move)]) + square_to_cord[get_move_target(move)];
+    if (get_move_promoted(move)) {
+        // promoted pieces are written in lower case for both sides
+        str += (char) (pieces[get_move_promoted(move)] | 0x20);
+    }
+    return str;
+}
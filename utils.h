@@ -6,6 +6,7 @@
 #define BITBOARDS_UTILS_H
 
 #include <cstdio>
+#include <string>
 
 #define U64 unsigned long long
 
@@ -104,15 +105,15 @@ const U64 rank_8 = 0x00000000000000ff;
 
 // encode move
 #define encode_move(source, target, piece, promoted, capture, double_push, enpassant, castling, captured_piece) \
- ((source) |             \
- (target << 6) |         \
- (piece << 12) |         \
- (promoted << 16) |      \
- (capture << 20) |       \
- (double_push << 21) |   \
- (enpassant << 22) |     \
- (castling << 23) |     \
- (captured_piece << 28))  \
+ ((source) |              \
+ ((target) << 6) |        \
+ ((piece) << 12) |        \
+ ((promoted) << 16) |     \
+ ((capture) << 20) |      \
+ ((double_push) << 21) |  \
+ ((enpassant) << 22) |    \
+ ((castling) << 23) |     \
+ ((captured_piece) << 28))
 // extract source square
 #define get_move_source(move) (move & 0x3f)
 
@@ -140,6 +141,37 @@ const U64 rank_8 = 0x00000000000000ff;
 // extract captured piece
 #define get_move_captured_piece(move) ((move & 0xF0000000) >> 28)
 
+// fixed capacity list of moves, kept on the stack so generating moves never touches the allocator
+// 218 is the most legal moves known in any position, so 256 always has room
+const int max_moves = 256;
+
+struct MoveList {
+    int moves[max_moves];
+    int count = 0;
+
+    void push_back(int move) { moves[count++] = move; }
+
+    int size() const { return count; }
+
+    bool empty() const { return count == 0; }
+
+    void clear() { count = 0; }
+
+    int &operator[](int index) { return moves[index]; }
+
+    int operator[](int index) const { return moves[index]; }
+
+    int *begin() { return moves; }
+
+    int *end() { return moves + count; }
+
+    const int *begin() const { return moves; }
+
+    const int *end() const { return moves + count; }
+};
+
 void print_bitboard(U64 bitboard);
 
+std::string move_to_string(int move);
+
 #endif //BITBOARDS_UTILS_H